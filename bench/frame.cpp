@@ -0,0 +1,262 @@
+/**
+ * \file
+ * \brief End-to-end frame-time benchmark on the headless backend.
+ *
+ * Runs the compositor with N headless outputs, spawns the benchmark client
+ * (frame_client.cpp) with M toplevels repainting at a fixed rate, and drives
+ * the pointer and the workspace scroll while it runs. At the end, the duration
+ * percentiles of the frame handler, of arrange_workspace and of the hit-test
+ * done on pointer motion are printed as JSON on stdout, with the number of
+ * surfaces drawn and culled by the frame handler and of the throttled frame
+ * callbacks of the hidden ones.
+ */
+
+extern "C" {
+#include <wayland-server.h>
+#include <wlr/backend.h>
+#include <wlr/types/wlr_cursor.h>
+#include <wlr/types/wlr_output_layout.h>
+#include <wlr/util/log.h>
+}
+
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+
+#include "Server.h"
+#include "SoftwareRenderer.h"
+#include "Stats.h"
+#include "ViewOperations.h"
+
+namespace {
+
+constexpr int POINTER_PERIOD_MS = 1;
+constexpr int SCROLL_PERIOD_MS = 16;
+constexpr int SCROLL_STEP = 40;
+
+struct Options {
+    int outputs = 1;
+    int clients = 4;
+    int rate = 60;
+    int duration = 10; ///< seconds
+    bool software = false; ///< composite on the CPU, see SOFTWARE_RENDERING_ENV
+    const char* client_path = nullptr;
+};
+
+struct Driver {
+    Server* server;
+    struct wl_event_source* pointer_timer;
+    struct wl_event_source* scroll_timer;
+    int pointer_step = 0;
+    int scroll_step = 0;
+};
+
+Server server;
+
+/// Sweeps the pointer across the whole output layout, one pixel row at a time.
+int pointer_timer_handler(void* data)
+{
+    auto* driver = static_cast<Driver*>(data);
+    auto& server = *driver->server;
+
+    struct wlr_box* layout_box = wlr_output_layout_get_box(server.output_manager->output_layout, nullptr);
+    if (layout_box->width > 0 && layout_box->height > 0) {
+        int step = driver->pointer_step++;
+        double x = layout_box->x + (step * 7) % layout_box->width;
+        double y = layout_box->y + (step * 7 / layout_box->width * 13) % layout_box->height;
+
+        wlr_cursor_warp_closest(server.seat.cursor.wlr_cursor, nullptr, x, y);
+        server.seat.process_cursor_motion(server);
+    }
+
+    wl_event_source_timer_update(driver->pointer_timer, POINTER_PERIOD_MS);
+    return 0;
+}
+
+/// Scrolls every workspace that is shown on an output back and forth.
+int scroll_timer_handler(void* data)
+{
+    auto* driver = static_cast<Driver*>(data);
+    auto& server = *driver->server;
+
+    // ten steps to the right, then ten steps to the left
+    int direction = (driver->scroll_step++ / 10) % 2 == 0 ? 1 : -1;
+    for (auto& ws : server.output_manager->workspaces) {
+        if (ws.output) {
+            scroll_workspace(*server.output_manager, ws, RelativeScroll(direction * SCROLL_STEP), false);
+        }
+    }
+
+    wl_event_source_timer_update(driver->scroll_timer, SCROLL_PERIOD_MS);
+    return 0;
+}
+
+int stop_timer_handler(void* data)
+{
+    wl_display_terminate(static_cast<Server*>(data)->wl_display);
+    return 0;
+}
+
+pid_t spawn_client(const Options& options)
+{
+    std::string clients = std::to_string(options.clients);
+    std::string rate = std::to_string(options.rate);
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        execl(options.client_path,
+              options.client_path,
+              "--clients",
+              clients.c_str(),
+              "--rate",
+              rate.c_str(),
+              nullptr);
+        std::perror("cardboard-frame-bench: couldn't execute the client");
+        _exit(EXIT_FAILURE);
+    }
+
+    return pid;
+}
+
+double to_us(Stats::Clock::duration duration)
+{
+    return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+/// Prints the percentiles of \a samples as a JSON object member.
+void print_samples(std::string_view name, Stats::Samples& samples, bool last)
+{
+    std::sort(samples.begin(), samples.end());
+
+    auto percentile = [&samples](double p) {
+        if (samples.empty()) {
+            return 0.;
+        }
+        auto index = static_cast<size_t>(std::ceil(p * samples.size())) - 1;
+        return to_us(samples[std::min(index, samples.size() - 1)]);
+    };
+
+    std::printf("    \"%.*s\": { \"count\": %zu, \"p50_us\": %.2f, \"p90_us\": %.2f, \"p99_us\": %.2f, \"max_us\": %.2f }%s\n",
+                static_cast<int>(name.size()),
+                name.data(),
+                samples.size(),
+                percentile(.5),
+                percentile(.9),
+                percentile(.99),
+                samples.empty() ? 0. : to_us(samples.back()),
+                last ? "" : ",");
+}
+
+void usage(const char* argv0)
+{
+    std::fprintf(stderr,
+                 "usage: %s [--outputs N] [--clients M] [--rate HZ] [--duration SECONDS] [--software] <path to cardboard-bench-client>\n",
+                 argv0);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if (arg == "--outputs" && i + 1 < argc) {
+            options.outputs = std::atoi(argv[++i]);
+        } else if (arg == "--clients" && i + 1 < argc) {
+            options.clients = std::atoi(argv[++i]);
+        } else if (arg == "--rate" && i + 1 < argc) {
+            options.rate = std::atoi(argv[++i]);
+        } else if (arg == "--duration" && i + 1 < argc) {
+            options.duration = std::atoi(argv[++i]);
+        } else if (arg == "--software") {
+            options.software = true;
+        } else if (!arg.starts_with("--") && options.client_path == nullptr) {
+            options.client_path = argv[i];
+        } else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (options.client_path == nullptr || options.outputs <= 0 || options.clients <= 0 || options.rate <= 0 || options.duration <= 0) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    wlr_log_init(WLR_ERROR, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+
+    std::string outputs = std::to_string(options.outputs);
+    setenv("WLR_BACKENDS", "headless", true);
+    setenv("WLR_HEADLESS_OUTPUTS", outputs.c_str(), true);
+    setenv("WLR_LIBINPUT_NO_DEVICES", "1", true);
+    if (options.software) {
+        setenv(SOFTWARE_RENDERING_ENV.data(), "1", true);
+    }
+
+    Stats stats;
+    server.stats = &stats;
+    if (!server.init()) {
+        return EXIT_FAILURE;
+    }
+
+    // like Server::run, without Xwayland, IPC and the config script
+    const char* socket = wl_display_add_socket_auto(server.wl_display);
+    if (!socket || !wlr_backend_start(server.backend)) {
+        std::fprintf(stderr, "cardboard-frame-bench: couldn't start the headless backend\n");
+        return EXIT_FAILURE;
+    }
+    setenv("WAYLAND_DISPLAY", socket, true);
+
+    pid_t client = spawn_client(options);
+    if (client < 0) {
+        std::perror("cardboard-frame-bench: couldn't fork");
+        return EXIT_FAILURE;
+    }
+
+    Driver driver = { .server = &server, .pointer_timer = nullptr, .scroll_timer = nullptr };
+    driver.pointer_timer = wl_event_loop_add_timer(server.event_loop, pointer_timer_handler, &driver);
+    driver.scroll_timer = wl_event_loop_add_timer(server.event_loop, scroll_timer_handler, &driver);
+    struct wl_event_source* stop_timer = wl_event_loop_add_timer(server.event_loop, stop_timer_handler, &server);
+    wl_event_source_timer_update(driver.pointer_timer, POINTER_PERIOD_MS);
+    wl_event_source_timer_update(driver.scroll_timer, SCROLL_PERIOD_MS);
+    wl_event_source_timer_update(stop_timer, options.duration * 1000);
+
+    wl_display_run(server.wl_display);
+
+    kill(client, SIGTERM);
+    waitpid(client, nullptr, 0);
+
+    wl_event_source_remove(driver.pointer_timer);
+    wl_event_source_remove(driver.scroll_timer);
+    wl_event_source_remove(stop_timer);
+    server.stats = nullptr;
+    server.stop();
+
+    std::printf("{\n");
+    std::printf("  \"outputs\": %d,\n", options.outputs);
+    std::printf("  \"clients\": %d,\n", options.clients);
+    std::printf("  \"rate_hz\": %d,\n", options.rate);
+    std::printf("  \"duration_s\": %d,\n", options.duration);
+    std::printf("  \"software\": %s,\n", options.software ? "true" : "false");
+    std::printf("  \"timings\": {\n");
+    print_samples("frame", stats.frame, false);
+    print_samples("arrange_workspace", stats.arrange, false);
+    print_samples("hit_test", stats.hit_test, true);
+    std::printf("  },\n");
+    std::printf("  \"rendered_surfaces\": %" PRIu64 ",\n", stats.rendered_surfaces);
+    std::printf("  \"culled_surfaces\": %" PRIu64 ",\n", stats.culled_surfaces);
+    std::printf("  \"throttled_frame_done\": %" PRIu64 "\n", stats.throttled_frame_done);
+    std::printf("}\n");
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,359 @@
+/**
+ * \file
+ * \brief Wayland client driven by the frame-time benchmark (see frame.cpp).
+ *
+ * Opens one connection per simulated client, each with a single xdg toplevel,
+ * and repaints every toplevel at a fixed rate with shared memory buffers.
+ * Runs until the compositor goes away or the process is terminated.
+ */
+
+extern "C" {
+#include <wayland-client.h>
+#include <xdg-shell-client-protocol.h>
+}
+
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+constexpr int DEFAULT_WIDTH = 640;
+constexpr int DEFAULT_HEIGHT = 480;
+
+struct Buffer {
+    struct wl_buffer* wl_buffer = nullptr;
+    void* data = nullptr;
+    size_t size = 0;
+    int width = 0, height = 0;
+    bool busy = false;
+    /// The window was resized while the compositor held this buffer, destroy it on release.
+    bool stale = false;
+};
+
+struct Window {
+    struct wl_surface* surface = nullptr;
+    struct xdg_surface* xdg_surface = nullptr;
+    struct xdg_toplevel* xdg_toplevel = nullptr;
+
+    int width = DEFAULT_WIDTH, height = DEFAULT_HEIGHT;
+    int pending_width = 0, pending_height = 0;
+    bool configured = false;
+    uint8_t shade = 0;
+
+    std::vector<std::unique_ptr<Buffer>> buffers;
+};
+
+struct Client {
+    struct wl_display* display = nullptr;
+    struct wl_registry* registry = nullptr;
+    struct wl_compositor* compositor = nullptr;
+    struct wl_shm* shm = nullptr;
+    struct xdg_wm_base* wm_base = nullptr;
+
+    Window window;
+};
+
+void destroy_buffer(Buffer& buffer)
+{
+    wl_buffer_destroy(buffer.wl_buffer);
+    munmap(buffer.data, buffer.size);
+}
+
+void buffer_release(void* data, struct wl_buffer*)
+{
+    auto* buffer = static_cast<Buffer*>(data);
+    buffer->busy = false;
+}
+
+const struct wl_buffer_listener buffer_listener = {
+    .release = buffer_release,
+};
+
+/// Returns a buffer of the current size of the window that the compositor doesn't hold, or nullptr.
+Buffer* get_free_buffer(Client& client)
+{
+    auto& window = client.window;
+    auto& buffers = window.buffers;
+
+    for (auto it = buffers.begin(); it != buffers.end();) {
+        auto& buffer = **it;
+        if (buffer.width != window.width || buffer.height != window.height) {
+            buffer.stale = true;
+        }
+        if (buffer.stale && !buffer.busy) {
+            destroy_buffer(buffer);
+            it = buffers.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    for (auto& buffer : buffers) {
+        if (!buffer->busy) {
+            return buffer.get();
+        }
+    }
+    if (buffers.size() >= 2) {
+        return nullptr;
+    }
+
+    const int stride = window.width * 4;
+    const size_t size = static_cast<size_t>(stride) * window.height;
+
+    int fd = memfd_create("cardboard-bench-client", MFD_CLOEXEC);
+    if (fd < 0 || ftruncate(fd, size) < 0) {
+        perror("cardboard-bench-client: couldn't allocate a buffer");
+        std::exit(EXIT_FAILURE);
+    }
+    void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        perror("cardboard-bench-client: couldn't map a buffer");
+        std::exit(EXIT_FAILURE);
+    }
+
+    struct wl_shm_pool* pool = wl_shm_create_pool(client.shm, fd, size);
+    auto buffer = std::make_unique<Buffer>();
+    buffer->wl_buffer = wl_shm_pool_create_buffer(pool, 0, window.width, window.height, stride, WL_SHM_FORMAT_XRGB8888);
+    buffer->data = data;
+    buffer->size = size;
+    buffer->width = window.width;
+    buffer->height = window.height;
+    wl_buffer_add_listener(buffer->wl_buffer, &buffer_listener, buffer.get());
+    wl_shm_pool_destroy(pool);
+    close(fd);
+
+    buffers.push_back(std::move(buffer));
+    return buffers.back().get();
+}
+
+/// Paints and commits a new frame, unless the compositor still holds both buffers.
+void repaint(Client& client)
+{
+    auto& window = client.window;
+    if (!window.configured) {
+        return;
+    }
+
+    Buffer* buffer = get_free_buffer(client);
+    if (buffer == nullptr) {
+        return;
+    }
+
+    std::memset(buffer->data, window.shade++, buffer->size);
+    buffer->busy = true;
+
+    wl_surface_attach(window.surface, buffer->wl_buffer, 0, 0);
+    wl_surface_damage_buffer(window.surface, 0, 0, buffer->width, buffer->height);
+    wl_surface_commit(window.surface);
+}
+
+void xdg_wm_base_ping(void*, struct xdg_wm_base* wm_base, uint32_t serial)
+{
+    xdg_wm_base_pong(wm_base, serial);
+}
+
+const struct xdg_wm_base_listener wm_base_listener = {
+    .ping = xdg_wm_base_ping,
+};
+
+void xdg_surface_configure(void* data, struct xdg_surface* xdg_surface, uint32_t serial)
+{
+    auto* client = static_cast<Client*>(data);
+    auto& window = client->window;
+
+    if (window.pending_width > 0 && window.pending_height > 0) {
+        window.width = window.pending_width;
+        window.height = window.pending_height;
+    }
+    xdg_surface_ack_configure(xdg_surface, serial);
+
+    // the first buffer goes out right away, the next ones at the rate of the benchmark
+    const bool first = !window.configured;
+    window.configured = true;
+    if (first) {
+        repaint(*client);
+    }
+}
+
+const struct xdg_surface_listener xdg_surface_listener = {
+    .configure = xdg_surface_configure,
+};
+
+void xdg_toplevel_configure(void* data, struct xdg_toplevel*, int32_t width, int32_t height, struct wl_array*)
+{
+    auto* client = static_cast<Client*>(data);
+    client->window.pending_width = width;
+    client->window.pending_height = height;
+}
+
+void xdg_toplevel_close(void*, struct xdg_toplevel*)
+{
+}
+
+const struct xdg_toplevel_listener xdg_toplevel_listener = {
+    .configure = xdg_toplevel_configure,
+    .close = xdg_toplevel_close,
+};
+
+void registry_global(void* data, struct wl_registry* registry, uint32_t name, const char* interface, uint32_t version)
+{
+    auto* client = static_cast<Client*>(data);
+    std::string_view iface = interface;
+
+    if (iface == wl_compositor_interface.name && version >= 4) {
+        client->compositor = static_cast<struct wl_compositor*>(
+            wl_registry_bind(registry, name, &wl_compositor_interface, 4));
+    } else if (iface == wl_shm_interface.name) {
+        client->shm = static_cast<struct wl_shm*>(
+            wl_registry_bind(registry, name, &wl_shm_interface, 1));
+    } else if (iface == xdg_wm_base_interface.name) {
+        client->wm_base = static_cast<struct xdg_wm_base*>(
+            wl_registry_bind(registry, name, &xdg_wm_base_interface, 1));
+        xdg_wm_base_add_listener(client->wm_base, &wm_base_listener, client);
+    }
+}
+
+void registry_global_remove(void*, struct wl_registry*, uint32_t)
+{
+}
+
+const struct wl_registry_listener registry_listener = {
+    .global = registry_global,
+    .global_remove = registry_global_remove,
+};
+
+bool connect_client(Client& client, int index)
+{
+    client.display = wl_display_connect(nullptr);
+    if (client.display == nullptr) {
+        std::fprintf(stderr, "cardboard-bench-client: couldn't connect to the compositor\n");
+        return false;
+    }
+
+    client.registry = wl_display_get_registry(client.display);
+    wl_registry_add_listener(client.registry, &registry_listener, &client);
+    wl_display_roundtrip(client.display);
+
+    if (client.compositor == nullptr || client.shm == nullptr || client.wm_base == nullptr) {
+        std::fprintf(stderr, "cardboard-bench-client: the compositor lacks a required global\n");
+        return false;
+    }
+
+    auto& window = client.window;
+    window.surface = wl_compositor_create_surface(client.compositor);
+    window.xdg_surface = xdg_wm_base_get_xdg_surface(client.wm_base, window.surface);
+    xdg_surface_add_listener(window.xdg_surface, &xdg_surface_listener, &client);
+    window.xdg_toplevel = xdg_surface_get_toplevel(window.xdg_surface);
+    xdg_toplevel_add_listener(window.xdg_toplevel, &xdg_toplevel_listener, &client);
+
+    char title[32];
+    std::snprintf(title, sizeof(title), "bench %d", index);
+    xdg_toplevel_set_title(window.xdg_toplevel, title);
+    wl_surface_commit(window.surface);
+
+    return true;
+}
+
+void usage(const char* argv0)
+{
+    std::fprintf(stderr, "usage: %s [--clients N] [--rate HZ]\n", argv0);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    int clients_number = 4;
+    int rate = 60;
+
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if (arg == "--clients" && i + 1 < argc) {
+            clients_number = std::atoi(argv[++i]);
+        } else if (arg == "--rate" && i + 1 < argc) {
+            rate = std::atoi(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (clients_number <= 0 || rate <= 0) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::vector<Client> clients(clients_number);
+    for (int i = 0; i < clients_number; i++) {
+        if (!connect_client(clients[i], i)) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    int timer = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+    const long period = 1'000'000'000L / rate;
+    struct itimerspec spec = {
+        .it_interval = { .tv_sec = period / 1'000'000'000L, .tv_nsec = period % 1'000'000'000L },
+        .it_value = { .tv_sec = period / 1'000'000'000L, .tv_nsec = period % 1'000'000'000L },
+    };
+    timerfd_settime(timer, 0, &spec, nullptr);
+
+    std::vector<struct pollfd> fds(clients_number + 1);
+    for (int i = 0; i < clients_number; i++) {
+        fds[i] = { .fd = wl_display_get_fd(clients[i].display), .events = POLLIN, .revents = 0 };
+    }
+    fds.back() = { .fd = timer, .events = POLLIN, .revents = 0 };
+
+    while (true) {
+        for (auto& client : clients) {
+            while (wl_display_prepare_read(client.display) != 0) {
+                wl_display_dispatch_pending(client.display);
+            }
+            if (wl_display_flush(client.display) < 0) {
+                return EXIT_SUCCESS; // the compositor is gone
+            }
+        }
+
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            for (auto& client : clients) {
+                wl_display_cancel_read(client.display);
+            }
+            continue;
+        }
+
+        for (int i = 0; i < clients_number; i++) {
+            auto& client = clients[i];
+            if (fds[i].revents & (POLLERR | POLLHUP)) {
+                return EXIT_SUCCESS;
+            }
+            if (fds[i].revents & POLLIN) {
+                if (wl_display_read_events(client.display) < 0) {
+                    return EXIT_SUCCESS;
+                }
+            } else {
+                wl_display_cancel_read(client.display);
+            }
+            if (wl_display_dispatch_pending(client.display) < 0) {
+                return EXIT_SUCCESS;
+            }
+        }
+
+        if (fds.back().revents & POLLIN) {
+            uint64_t expirations;
+            if (read(timer, &expirations, sizeof(expirations)) == sizeof(expirations)) {
+                for (auto& client : clients) {
+                    repaint(client);
+                }
+            }
+        }
+    }
+}
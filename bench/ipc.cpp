@@ -0,0 +1,163 @@
+/**
+ * \file
+ * \brief Benchmarks the IPC command path over a local socket.
+ *
+ * The compositor side runs the real IPC class on its own event loop, with a command callback
+ * that only writes a response, while a client thread sends commands with libcutter::Client, one round-trip
+ * at a time and in pipelined batches. Prints commands per second and the heap allocations made
+ * by the compositor side per command, which are expected to be 0 once its buffers are warmed up.
+ */
+
+extern "C" {
+#include <wayland-server.h>
+#include <wlr/util/log.h>
+}
+
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <cardboard/client.h>
+#include <cardboard/command_protocol.h>
+#include <cardboard/ipc.h>
+
+#include "IPC.h"
+#include "Server.h"
+
+namespace {
+
+constexpr size_t ROUND_TRIPS = 20000;
+constexpr size_t BATCH_SIZE = 1000;
+constexpr size_t BATCHES = 50;
+
+/// Set on the thread that runs the compositor side, whose allocations are counted.
+thread_local bool count_allocations = false;
+std::atomic<size_t> allocations = 0;
+
+Server server;
+
+} // namespace
+
+void* operator new(std::size_t size)
+{
+    if (count_allocations) {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (void* p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace {
+
+/// Measures \a op, which sends \a commands commands, and prints its throughput.
+template <typename F>
+void measure(const char* name, size_t commands, F&& op)
+{
+    using Clock = std::chrono::steady_clock;
+
+    size_t allocations_before = allocations.load();
+    auto begin = Clock::now();
+    op();
+    auto elapsed = std::chrono::duration<double>(Clock::now() - begin);
+    size_t server_allocations = allocations.load() - allocations_before;
+
+    std::printf("%-12s %8zu commands %12.0f commands/s %8.3f allocations/command\n",
+                name,
+                commands,
+                static_cast<double>(commands) / elapsed.count(),
+                static_cast<double>(server_allocations) / static_cast<double>(commands));
+}
+
+void run_client(std::atomic<bool>& done)
+{
+    libcutter::Client client = libcutter::open_client()
+                                   .map_error([](const std::string& error) {
+                                       std::fprintf(stderr, "cardboard-ipc-bench: %s\n", error.c_str());
+                                       std::exit(EXIT_FAILURE);
+                                   })
+                                   .value();
+
+    const CommandData command = command_arguments::focus { command_arguments::focus::Direction::Left, false };
+
+    // warm up the buffers of both sides, pipelined batches need the largest ones
+    for (size_t i = 0; i < 100; i++) {
+        client.send_command(command);
+        client.wait_response();
+    }
+    client.send_batch(std::vector<CommandData>(BATCH_SIZE, command));
+
+    measure("round-trip", ROUND_TRIPS, [&]() {
+        for (size_t i = 0; i < ROUND_TRIPS; i++) {
+            if (!client.send_command(command) || !client.wait_response()) {
+                std::fprintf(stderr, "cardboard-ipc-bench: round-trip failed\n");
+                std::exit(EXIT_FAILURE);
+            }
+        }
+    });
+
+    const std::vector<CommandData> batch(BATCH_SIZE, command);
+    measure("pipelined", BATCH_SIZE * BATCHES, [&]() {
+        for (size_t i = 0; i < BATCHES; i++) {
+            if (!client.send_batch(batch)) {
+                std::fprintf(stderr, "cardboard-ipc-bench: batch failed\n");
+                std::exit(EXIT_FAILURE);
+            }
+        }
+    });
+
+    done = true;
+}
+
+} // namespace
+
+int main()
+{
+    wlr_log_init(WLR_ERROR, nullptr);
+
+    std::string socket_path = "/tmp/cardboard-ipc-bench-" + std::to_string(getpid());
+    setenv(libcardboard::ipc::SOCKET_ENV_VAR, socket_path.c_str(), true);
+
+    server.wl_display = wl_display_create();
+    server.event_loop = wl_display_get_event_loop(server.wl_display);
+    server.ipc = create_ipc(server, socket_path, [](const CommandData&, std::string& response) {
+                     // longer than the small string optimization, to see that the buffer is reused
+                     response.append("a response that doesn't fit in a small string");
+                 }).value();
+
+    std::atomic<bool> done = false;
+    std::thread client_thread(run_client, std::ref(done));
+
+    count_allocations = true;
+    while (!done) {
+        wl_event_loop_dispatch(server.event_loop, 10);
+    }
+    count_allocations = false;
+
+    client_thread.join();
+
+    server.ipc = nullptr;
+    wl_display_destroy(server.wl_display);
+    unlink(socket_path.c_str());
+
+    return EXIT_SUCCESS;
+}
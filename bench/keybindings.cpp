@@ -0,0 +1,188 @@
+/**
+ * \file
+ * \brief Benchmarks the latency of key events through the keyboard key handler.
+ *
+ * A virtual keyboard with the default keymap is attached to a seat without any client,
+ * a few hundred key bindings are configured, and key presses are fed to wlroots, which
+ * emits them to KeyboardHandleData::key_handler. Prints the cost of a key event that
+ * matches a binding, of one that is forwarded to the (absent) focused client, of a two-key
+ * chord and of the key binding lookup alone.
+ */
+
+extern "C" {
+#include <linux/input-event-codes.h>
+#include <wayland-server.h>
+#include <wlr/interfaces/wlr_input_device.h>
+#include <wlr/interfaces/wlr_keyboard.h>
+#include <wlr/types/wlr_seat.h>
+#include <wlr/util/log.h>
+#include <xkbcommon/xkbcommon.h>
+}
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include "Keyboard.h"
+#include "Server.h"
+
+namespace {
+
+constexpr size_t ITERATIONS = 200000;
+
+constexpr uint32_t LETTER_KEYCODES[] = {
+    KEY_A, KEY_B, KEY_C, KEY_D, KEY_E, KEY_F, KEY_G, KEY_H, KEY_I, KEY_J, KEY_K, KEY_L, KEY_M,
+    KEY_N, KEY_O, KEY_P, KEY_Q, KEY_R, KEY_S, KEY_T, KEY_U, KEY_V, KEY_W, KEY_X, KEY_Y, KEY_Z
+};
+constexpr size_t LETTER_COUNT = sizeof(LETTER_KEYCODES) / sizeof(LETTER_KEYCODES[0]);
+
+/// Keeps the results of the measured functions alive.
+volatile size_t sink;
+size_t commands_run = 0;
+
+Server server;
+
+const struct wlr_keyboard_impl keyboard_impl = {
+    .destroy = nullptr,
+    .led_update = nullptr,
+};
+
+const struct wlr_input_device_impl input_device_impl = {
+    .destroy = nullptr,
+};
+
+void notify_key(struct wlr_keyboard* keyboard, uint32_t keycode, enum wlr_key_state state)
+{
+    struct wlr_event_keyboard_key event = {};
+    event.keycode = keycode;
+    event.state = state;
+    event.update_state = true;
+    wlr_keyboard_notify_key(keyboard, &event);
+}
+
+/// Runs \a op ITERATIONS times and prints its average cost in nanoseconds.
+template <typename F>
+void measure(const char* name, F&& op)
+{
+    using Clock = std::chrono::steady_clock;
+
+    auto begin = Clock::now();
+    for (size_t i = 0; i < ITERATIONS; i++) {
+        op(i);
+    }
+    auto elapsed = std::chrono::duration<double, std::nano>(Clock::now() - begin);
+
+    std::printf("%-16s %10.1f ns\n", name, elapsed.count() / static_cast<double>(ITERATIONS));
+}
+
+CommandResult count_command(Server*)
+{
+    commands_run++;
+    return { "" };
+}
+
+/// Binds every letter under every combination of ctrl, alt, super and shift, and chords of ctrl+w and a letter.
+size_t configure_bindings()
+{
+    size_t bindings = 0;
+
+    const uint32_t modifiers[] = { WLR_MODIFIER_CTRL, WLR_MODIFIER_ALT, WLR_MODIFIER_LOGO, WLR_MODIFIER_SHIFT };
+
+    for (uint32_t combination = 1; combination < 16; combination++) {
+        uint32_t mask = 0;
+        for (uint32_t bit = 0; bit < 4; bit++) {
+            if (combination & (1 << bit)) {
+                mask |= modifiers[bit];
+            }
+        }
+        for (xkb_keysym_t sym = XKB_KEY_a; sym <= XKB_KEY_z; sym++) {
+            KeyCombo key = { mask, sym };
+            server.keybindings_config.bind(KeybindingsConfig::DEFAULT_MODE, { &key, 1 }, count_command);
+            bindings++;
+        }
+    }
+
+    for (xkb_keysym_t sym = XKB_KEY_a; sym <= XKB_KEY_z; sym++) {
+        KeyCombo keys[] = { { WLR_MODIFIER_CTRL, XKB_KEY_w }, { 0, sym } };
+        server.keybindings_config.bind(KeybindingsConfig::DEFAULT_MODE, keys, count_command);
+        bindings++;
+    }
+
+    return bindings;
+}
+
+} // namespace
+
+int main()
+{
+    wlr_log_init(WLR_ERROR, nullptr);
+
+    server.wl_display = wl_display_create();
+    server.seat.wlr_seat = wlr_seat_create(server.wl_display, "seat0");
+
+    size_t bindings = configure_bindings();
+
+    // without a destroy implementation, wlroots frees both structures itself
+    auto* wlr_keyboard = static_cast<struct wlr_keyboard*>(std::calloc(1, sizeof(struct wlr_keyboard)));
+    auto* device = static_cast<struct wlr_input_device*>(std::calloc(1, sizeof(struct wlr_input_device)));
+    wlr_keyboard_init(wlr_keyboard, &keyboard_impl);
+    wlr_input_device_init(device, WLR_INPUT_DEVICE_KEYBOARD, &input_device_impl, "cardboard-bench-keyboard", 0, 0);
+    device->keyboard = wlr_keyboard;
+
+    // like Seat's add_keyboard
+    server.seat.keyboards.push_back(Keyboard { device });
+    auto& keyboard = server.seat.keyboards.back();
+    device->data = &keyboard;
+
+    struct xkb_rule_names rules = {};
+    struct xkb_context* context = xkb_context_new(XKB_CONTEXT_NO_FLAGS);
+    struct xkb_keymap* keymap = xkb_map_new_from_names(context, &rules, XKB_KEYMAP_COMPILE_NO_FLAGS);
+    wlr_keyboard_set_keymap(wlr_keyboard, keymap);
+    xkb_keymap_unref(keymap);
+    xkb_context_unref(context);
+
+    register_keyboard_handlers(server, server.seat, keyboard);
+    wlr_seat_set_keyboard(server.seat.wlr_seat, device);
+
+    std::printf("%zu key bindings\n", bindings);
+
+    measure("lookup", [](size_t i) {
+        sink = sink + (server.keybindings_config.find({ WLR_MODIFIER_LOGO, static_cast<xkb_keysym_t>(XKB_KEY_a + i % 26) }) != nullptr);
+    });
+
+    measure("unbound key", [wlr_keyboard](size_t i) {
+        uint32_t keycode = LETTER_KEYCODES[i % LETTER_COUNT];
+        notify_key(wlr_keyboard, keycode, WLR_KEY_PRESSED);
+        notify_key(wlr_keyboard, keycode, WLR_KEY_RELEASED);
+    });
+
+    notify_key(wlr_keyboard, KEY_LEFTMETA, WLR_KEY_PRESSED);
+    measure("bound key", [wlr_keyboard](size_t i) {
+        uint32_t keycode = LETTER_KEYCODES[i % LETTER_COUNT];
+        notify_key(wlr_keyboard, keycode, WLR_KEY_PRESSED);
+        notify_key(wlr_keyboard, keycode, WLR_KEY_RELEASED);
+    });
+    notify_key(wlr_keyboard, KEY_LEFTMETA, WLR_KEY_RELEASED);
+
+    // ctrl+w, then a letter: four key events per run instead of two
+    measure("chord", [wlr_keyboard](size_t i) {
+        uint32_t keycode = LETTER_KEYCODES[i % LETTER_COUNT];
+        notify_key(wlr_keyboard, KEY_LEFTCTRL, WLR_KEY_PRESSED);
+        notify_key(wlr_keyboard, KEY_W, WLR_KEY_PRESSED);
+        notify_key(wlr_keyboard, KEY_W, WLR_KEY_RELEASED);
+        notify_key(wlr_keyboard, KEY_LEFTCTRL, WLR_KEY_RELEASED);
+        notify_key(wlr_keyboard, keycode, WLR_KEY_PRESSED);
+        notify_key(wlr_keyboard, keycode, WLR_KEY_RELEASED);
+    });
+
+    if (commands_run != 2 * ITERATIONS) {
+        std::fprintf(stderr, "cardboard-keybindings-bench: expected %zu commands, ran %zu\n", 2 * ITERATIONS, commands_run);
+        return EXIT_FAILURE;
+    }
+
+    wlr_input_device_destroy(device);
+    wlr_seat_destroy(server.seat.wlr_seat);
+    wl_display_destroy(server.wl_display);
+
+    return EXIT_SUCCESS;
+}
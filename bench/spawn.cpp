@@ -0,0 +1,165 @@
+/**
+ * \file
+ * \brief Benchmarks how long launching a program stalls the compositor thread.
+ *
+ * The process first maps and touches a ballast of memory, standing in for the buffers a running
+ * compositor has mapped, then launches a short program many times in a row, with spawn() and with
+ * the fork-based implementation it replaced. Each launch is timed from the call until it returns,
+ * which is how long the event loop can't render frames. Prints the percentiles of both.
+ */
+
+extern "C" {
+#include <wlr/util/log.h>
+}
+
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Server.h"
+#include "Spawn.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    int launches = 200;
+    int ballast_mib = 512;
+    const char* program = "true";
+};
+
+Server server;
+
+/// Like spawn() before it used posix_spawn: fork, then block until the child execs or fails.
+int fork_spawn(const char* program)
+{
+    int fd[2];
+    if (pipe(fd) == -1) {
+        return errno;
+    }
+    if (fork() == 0) {
+        close(fd[0]);
+        fcntl(fd[1], F_SETFD, FD_CLOEXEC);
+
+        setsid();
+        execlp(program, program, nullptr);
+
+        int error = errno;
+        [[maybe_unused]] ssize_t written = write(fd[1], &error, sizeof(error));
+        _exit(EXIT_FAILURE);
+    }
+
+    close(fd[1]);
+
+    int code = 0;
+    if (read(fd[0], &code, sizeof(code)) <= 0) {
+        code = 0;
+    }
+    close(fd[0]);
+    return code;
+}
+
+void reap_children()
+{
+    while (waitpid(-1, nullptr, 0) > 0)
+        ;
+    server.children.clear();
+}
+
+double to_us(Clock::duration duration)
+{
+    return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+/// Launches the program \a launches times with \a launch and prints the percentiles of the stalls.
+template <typename F>
+bool measure(const char* name, int launches, F&& launch)
+{
+    std::vector<Clock::duration> stalls;
+    stalls.reserve(launches);
+
+    for (int i = 0; i < launches; i++) {
+        auto begin = Clock::now();
+        bool launched = launch();
+        stalls.push_back(Clock::now() - begin);
+
+        if (!launched) {
+            std::fprintf(stderr, "cardboard-spawn-bench: %s couldn't launch the program\n", name);
+            return false;
+        }
+    }
+    reap_children();
+
+    std::sort(stalls.begin(), stalls.end());
+    auto percentile = [&stalls](double p) {
+        auto index = static_cast<size_t>(std::ceil(p * stalls.size())) - 1;
+        return to_us(stalls[std::min(index, stalls.size() - 1)]);
+    };
+
+    std::printf("%-12s %6d launches  p50 %9.1f us  p99 %9.1f us  max %9.1f us\n",
+                name,
+                launches,
+                percentile(.5),
+                percentile(.99),
+                to_us(stalls.back()));
+    return true;
+}
+
+void usage(const char* argv0)
+{
+    std::fprintf(stderr, "usage: %s [--launches N] [--ballast-mib MIB] [--program PROGRAM]\n", argv0);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if (arg == "--launches" && i + 1 < argc) {
+            options.launches = std::atoi(argv[++i]);
+        } else if (arg == "--ballast-mib" && i + 1 < argc) {
+            options.ballast_mib = std::atoi(argv[++i]);
+        } else if (arg == "--program" && i + 1 < argc) {
+            options.program = argv[++i];
+        } else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (options.launches <= 0 || options.ballast_mib < 0) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    wlr_log_init(WLR_ERROR, nullptr);
+
+    // touch every page, fork has to copy the page tables of all of them
+    size_t ballast_size = static_cast<size_t>(options.ballast_mib) << 20;
+    std::vector<char> ballast(ballast_size);
+    std::memset(ballast.data(), 1, ballast.size());
+
+    std::printf("%d MiB mapped, launching %s\n", options.ballast_mib, options.program);
+
+    const std::vector<std::string> program_argv = { options.program };
+    bool ok = measure("posix_spawn", options.launches, [&program_argv]() {
+        return spawn(server, program_argv).has_value();
+    });
+    ok = ok && measure("fork", options.launches, [&options]() {
+        return fork_spawn(options.program) == 0;
+    });
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
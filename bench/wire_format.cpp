@@ -0,0 +1,74 @@
+/**
+ * \file
+ * \brief Measures the binary wire format of CommandData.
+ *
+ * Prints the encoded size and the encode and decode throughput of a few typical commands.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <cardboard/command_protocol.h>
+
+namespace {
+
+constexpr size_t ITERATIONS = 200000;
+
+/// Keeps the results of the measured functions alive.
+volatile size_t sink;
+
+struct Sample {
+    const char* name;
+    CommandData command;
+};
+
+/// Runs \a op ITERATIONS times and returns the number of runs per second.
+template <typename F>
+double measure(F&& op)
+{
+    using Clock = std::chrono::steady_clock;
+
+    auto begin = Clock::now();
+    for (size_t i = 0; i < ITERATIONS; i++) {
+        op();
+    }
+    auto elapsed = std::chrono::duration<double>(Clock::now() - begin);
+
+    return static_cast<double>(ITERATIONS) / elapsed.count();
+}
+
+void bench_sample(const Sample& sample)
+{
+    std::string binary = write_command_data(sample.command).value();
+    std::vector<std::byte> buffer(binary.size());
+
+    double binary_encode = measure([&]() {
+        sink = sink + encode_command(sample.command, buffer);
+    });
+    double binary_decode = measure([&]() {
+        sink = sink + read_command_data(binary.data(), binary.size())->index();
+    });
+
+    std::printf("%-12s %4zu bytes %12.0f encodes/s %12.0f decodes/s\n", sample.name, binary.size(), binary_encode, binary_decode);
+}
+
+} // namespace
+
+int main()
+{
+    const std::vector<Sample> samples = {
+        { "focus", command_arguments::focus { command_arguments::focus::Direction::Left, false } },
+        { "workspace", command_arguments::workspace { command_arguments::workspace::switch_ { 3 } } },
+        { "exec", command_arguments::exec { { "toolbox", "run", "swaybg", "-i", "/home/user/wallpapers/autobahn.png" } } },
+        { "bind", command_arguments::bind { { "alt", "shift" }, "return", command_arguments::exec { { "sakura" } } } },
+    };
+
+    for (const auto& sample : samples) {
+        bench_sample(sample);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,241 @@
+/**
+ * \file
+ * \brief Benchmarks the tiling engine (Workspace) against mock views and a fake output,
+ * without a backend, a renderer or any client.
+ *
+ * Prints the cost of each operation in nanoseconds, for workspaces of increasing size,
+ * and how many of the sizes requested by the layout were sent to the views.
+ */
+
+extern "C" {
+#include <wayland-server.h>
+#include <wlr/backend/interface.h>
+#include <wlr/interfaces/wlr_output.h>
+#include <wlr/types/wlr_output_damage.h>
+#include <wlr/types/wlr_output_layout.h>
+#include <wlr/util/log.h>
+}
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "Output.h"
+#include "OutputManager.h"
+#include "Server.h"
+#include "View.h"
+#include "Workspace.h"
+
+namespace {
+
+constexpr int OUTPUT_WIDTH = 1920;
+constexpr int OUTPUT_HEIGHT = 1080;
+
+/// A view whose client accepts every size right away.
+class BenchView final : public View {
+public:
+    BenchView(int width)
+    {
+        geometry = { 0, 0, width, OUTPUT_HEIGHT };
+        mapped = true;
+        new_view = false;
+    }
+
+    struct wlr_surface* get_surface() final { return nullptr; }
+    bool get_surface_under_coords(double, double, struct wlr_surface*&, double&, double&) final { return false; }
+    void prepare(Server&) final { }
+    void set_activated(bool) final { }
+    void set_fullscreen(bool) final { }
+    void for_each_surface(wlr_surface_iterator_func_t, void*) final { }
+    bool is_transient_for(View&) final { return false; }
+    void close_popups() final { }
+    void close() final { }
+
+protected:
+    bool send_size(int width, int height) final
+    {
+        geometry.width = width;
+        geometry.height = height;
+        return false;
+    }
+
+    bool is_size_in_flight() final { return false; }
+};
+
+bool fake_output_attach_render(struct wlr_output*, int*)
+{
+    return false;
+}
+
+bool fake_output_commit(struct wlr_output*)
+{
+    return true;
+}
+
+void fake_output_destroy(struct wlr_output*)
+{
+}
+
+const struct wlr_backend_impl fake_backend_impl = {};
+
+const struct wlr_output_impl fake_output_impl = {
+    .destroy = fake_output_destroy,
+    .attach_render = fake_output_attach_render,
+    .commit = fake_output_commit,
+};
+
+/// A server with a single fake output and an active workspace on it, enough for Workspace to work.
+struct BenchServer {
+    struct wl_display* display;
+    struct wlr_backend backend = {};
+    struct wlr_output wlr_output = {};
+    Server server;
+
+    BenchServer()
+    {
+        display = wl_display_create();
+        wlr_backend_init(&backend, &fake_backend_impl);
+        wlr_output_init(&wlr_output, &backend, &fake_output_impl, display);
+        wlr_output_update_custom_mode(&wlr_output, OUTPUT_WIDTH, OUTPUT_HEIGHT, 60000);
+
+        server.wl_display = display;
+        server.event_loop = wl_display_get_event_loop(display);
+        server.output_manager = std::make_unique<OutputManager>();
+        server.output_manager->output_layout = wlr_output_layout_create();
+        wlr_output_layout_add(server.output_manager->output_layout, &wlr_output, 0, 0);
+
+        server.output_manager->outputs.push_back(Output {
+            .wlr_output = &wlr_output,
+            .damage = wlr_output_damage_create(&wlr_output),
+            .usable_area = { 0, 0, OUTPUT_WIDTH, OUTPUT_HEIGHT },
+            .last_present = {},
+        });
+    }
+
+    /// Returns a fresh workspace shown on the fake output.
+    Workspace& create_workspace()
+    {
+        server.output_manager->workspaces.clear();
+        auto& workspace = server.output_manager->create_workspace(&server);
+        workspace.activate(server.output_manager->outputs.front());
+        workspace.suspend_animations = true;
+        server.seat.focus_stack.clear();
+
+        return workspace;
+    }
+
+    /// Tiles \a view in \a workspace in its own column on the right, the same way mapping does.
+    void add(Workspace& workspace, BenchView& view)
+    {
+        view.workspace_id = workspace.index;
+        workspace.add_view(*server.output_manager, view, nullptr, false, true);
+        server.seat.focus_stack.push_front(&view);
+    }
+};
+
+std::vector<std::unique_ptr<BenchView>> make_views(size_t count)
+{
+    std::vector<std::unique_ptr<BenchView>> views;
+    views.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        // a few different widths, so that the layout isn't uniform
+        views.push_back(std::make_unique<BenchView>(OUTPUT_WIDTH / static_cast<int>(2 + i % 3)));
+    }
+
+    return views;
+}
+
+/// Keeps the results of the measured functions alive.
+volatile long sink;
+
+/// Runs \a op \a iterations times and prints the mean time of one run.
+template <typename F>
+void measure(const char* name, size_t tiles, size_t iterations, F&& op)
+{
+    using Clock = std::chrono::steady_clock;
+
+    auto begin = Clock::now();
+    for (size_t i = 0; i < iterations; i++) {
+        op(i);
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin);
+
+    std::printf("%-26s %6zu tiles %14.1f ns/op\n", name, tiles, static_cast<double>(elapsed.count()) / static_cast<double>(iterations));
+}
+
+void bench_workspace(BenchServer& bench, size_t tiles)
+{
+    auto& output_manager = *bench.server.output_manager;
+    auto& seat = bench.server.seat;
+    auto views = make_views(tiles);
+    // enough iterations for the fast operations to be measurable, without taking forever on large workspaces
+    const size_t iterations = std::max<size_t>(100, 1000000 / tiles);
+    // visits the views in a scattered order
+    auto view_at = [&views, tiles](size_t i) -> BenchView& { return *views[(i * 7919) % tiles]; };
+
+    auto& workspace = bench.create_workspace();
+
+    measure("add_view", tiles, tiles, [&](size_t i) {
+        bench.add(workspace, *views[i]);
+    });
+    measure("find_column", tiles, iterations, [&](size_t i) {
+        sink = sink + (workspace.find_column(&view_at(i)) != workspace.columns.end());
+    });
+    measure("get_view_wx", tiles, iterations, [&](size_t i) {
+        sink = sink + workspace.get_view_wx(view_at(i));
+    });
+    measure("arrange_workspace", tiles, iterations, [&](size_t) {
+        workspace.invalidate_layout();
+        workspace.arrange_workspace(output_manager);
+    });
+    measure("arrange_workspace (scroll)", tiles, iterations, [&](size_t i) {
+        workspace.scroll_x = static_cast<int>(i % OUTPUT_WIDTH);
+        workspace.arrange_workspace(output_manager);
+    });
+    measure("fit_view_on_screen", tiles, iterations, [&](size_t i) {
+        workspace.fit_view_on_screen(output_manager, view_at(i));
+    });
+    measure("find_dominant_view", tiles, iterations, [&](size_t) {
+        sink = sink + workspace.find_dominant_view(output_manager, seat, OptionalRef<View>(views.front().get())).has_value();
+    });
+    measure("remove_view", tiles, tiles, [&](size_t i) {
+        workspace.remove_view(output_manager, *views[i], true);
+    });
+
+    // how many of the sizes computed by the layout reached the clients
+    View::ResizeCounters resizes;
+    for (const auto& view : views) {
+        resizes.requested += view->resize_counters.requested;
+        resizes.suppressed += view->resize_counters.suppressed;
+        resizes.coalesced += view->resize_counters.coalesced;
+        resizes.sent += view->resize_counters.sent;
+        resizes.timed_out += view->resize_counters.timed_out;
+    }
+    std::printf("%-26s %6zu tiles %10" PRIu64 " requested %10" PRIu64 " suppressed %10" PRIu64 " coalesced %10" PRIu64 " sent %10" PRIu64 " timed out\n",
+                "resizes",
+                tiles,
+                resizes.requested,
+                resizes.suppressed,
+                resizes.coalesced,
+                resizes.sent,
+                resizes.timed_out);
+
+    seat.focus_stack.clear();
+}
+
+} // namespace
+
+int main()
+{
+    wlr_log_init(WLR_ERROR, nullptr);
+
+    BenchServer bench;
+    for (size_t tiles : { 1, 10, 100, 1000, 10000 }) {
+        bench_workspace(bench, tiles);
+    }
+
+    return 0;
+}
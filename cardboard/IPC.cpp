@@ -3,10 +3,12 @@ extern "C" {
 }
 
 #include <fcntl.h>
-#include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <array>
 #include <cerrno>
 #include <cstdint>
 #include <cstring>
@@ -20,7 +22,7 @@ extern "C" {
 std::optional<IPCInstance> create_ipc(
     Server& server,
     const std::string& socket_path,
-    std::function<std::string(const CommandData&)> command_callback)
+    CommandCallback command_callback)
 {
     int ipc_socket_fd = socket(AF_UNIX, SOCK_STREAM, 0);
 
@@ -92,16 +94,13 @@ int IPC::handle_client_connection(int /*fd*/, uint32_t mask, void* data)
     }
 
     if ((flags = fcntl(client_fd, F_GETFL)) == -1
-        || fcntl(client_fd, F_GETFL, flags | O_NONBLOCK) == -1) {
+        || fcntl(client_fd, F_SETFL, flags | O_NONBLOCK) == -1) {
         wlr_log(WLR_ERROR, "Unable to set O_NONBLOCK on IPC client socket: %s", strerror(errno));
         close(client_fd);
         return 0;
     }
 
-    ipc->clients.emplace_back(
-        ipc,
-        client_fd,
-        IPC::ClientState::READING_HEADER);
+    ipc->clients.emplace_back(ipc, client_fd);
 
     ipc->clients.back().readable_event_source = wl_event_loop_add_fd(
         ipc->server->event_loop,
@@ -129,83 +128,40 @@ int IPC::handle_client_readable(int /*fd*/, uint32_t mask, void* data)
         return 0;
     }
 
-    int available_bytes;
-    if (ioctl(client->client_fd, FIONREAD, &available_bytes) == -1) {
-        wlr_log(WLR_INFO, "Unable to read pending available data");
-        client->ipc->remove_client(client);
-        return 0;
+    // receive straight into the input buffer, which only grows, and only when the bytes it holds leave too little room
+    if (client->input.size() - client->input_size < READ_CHUNK_SIZE) {
+        client->input.resize(client->input_size + READ_CHUNK_SIZE);
     }
+    ssize_t received = recv(client->client_fd, client->input.data() + client->input_size, client->input.size() - client->input_size, 0);
+    client->input_size += std::max<ssize_t>(received, 0);
 
-    switch (client->state) {
-    case IPC::ClientState::READING_HEADER: {
-        if (available_bytes < static_cast<int>(libcardboard::ipc::HEADER_SIZE)) {
-            break;
-        }
-
-        libcardboard::ipc::AlignedHeaderBuffer buffer;
-        if (ssize_t received = recv(
-                client->client_fd,
-                buffer.data(),
-                libcardboard::ipc::HEADER_SIZE,
-                0);
-            received != -1) {
-            libcardboard::ipc::Header header = libcardboard::ipc::interpret_header(buffer);
-            client->payload_size = header.incoming_bytes;
-            client->state = IPC::ClientState::READING_PAYLOAD;
-
-            available_bytes -= received;
-
-            if (client->payload_size <= available_bytes) {
-                // do nothing jumps to the IPC::ClientState::READING_PAYLOAD case
-            } else {
-                break;
-            }
-        } else {
-            wlr_log(WLR_INFO, "recv failed on header");
-            client->ipc->remove_client(client);
+    if (received == -1) {
+        if (errno == EAGAIN || errno == EINTR) {
             return 0;
         }
-        [[fallthrough]];
+
+        wlr_log(WLR_INFO, "Unable to receive data from IPC client: %s", strerror(errno));
+        client->ipc->remove_client(client);
+        return 0;
     }
-    case IPC::ClientState::READING_PAYLOAD: {
-        if (client->payload_size > available_bytes)
-            break;
 
-        auto* buffer = new std::byte[client->payload_size];
-        if (ssize_t received = recv(
-                client->client_fd,
-                buffer,
-                client->payload_size,
-                0);
-            received == -1) {
-            wlr_log(WLR_INFO, "couldn't read payload");
+    if (received == 0) {
+        // the client closed its end, answer what it sent and disconnect it
+        client->closing = true;
+        wl_event_source_remove(client->readable_event_source);
+        client->readable_event_source = nullptr;
+
+        if (!client->ipc->flush_responses(*client) || client->output.empty()) {
             client->ipc->remove_client(client);
-            return 0;
         }
-        read_command_data(buffer, client->payload_size)
-            .map([client](const CommandData& command_data) {
-                client->message = client->ipc->command_callback(command_data);
-            })
-            .map_error([client](const std::string& error) {
-                using namespace std::string_literals;
-                wlr_log(WLR_INFO, "unable to parse command: %s", error.c_str());
-                client->message = "Unable to parse command: " + error;
-            });
-        delete[] buffer;
-
-        client->writable_event_source = wl_event_loop_add_fd(
-            client->ipc->server->event_loop,
-            client->client_fd,
-            WL_EVENT_WRITABLE,
-            IPC::handle_client_writeable,
-            client);
-
-        client->state = IPC::ClientState::WRITING;
-        break;
+        return 0;
     }
-    case IPC::ClientState::WRITING:
-        break; // do nothing
+
+    if (!client->ipc->process_commands(*client) || !client->ipc->flush_responses(*client)) {
+        client->ipc->remove_client(client);
+        return 0;
     }
+    client->ipc->watch_readable(*client);
 
     return 0;
 }
@@ -226,32 +182,214 @@ int IPC::handle_client_writeable(int /*fd*/, uint32_t mask, void* data)
         return 0;
     }
 
-    if (!client->message.empty()) {
-        libcardboard::ipc::AlignedHeaderBuffer header = libcardboard::ipc::create_header_buffer({ static_cast<int>(client->message.size()) });
+    if (!client->ipc->flush_responses(*client) || (client->closing && client->output.empty())) {
+        client->ipc->remove_client(client);
+        return 0;
+    }
+    client->ipc->watch_readable(*client);
+
+    return 0;
+}
 
-        auto* buffer = new std::byte[client->message.empty() + header.size()];
-        std::copy(
-            header.begin(),
-            header.end(),
-            buffer);
+bool IPC::process_commands(IPC::Client& client)
+{
+    size_t offset = 0;
+
+    while (client.input_size - offset >= libcardboard::ipc::HEADER_SIZE) {
+        libcardboard::ipc::AlignedHeaderBuffer header_buffer;
+        std::copy_n(client.input.begin() + offset, libcardboard::ipc::HEADER_SIZE, header_buffer.begin());
+        auto maybe_header = libcardboard::ipc::interpret_header(header_buffer);
+        if (!maybe_header) {
+            wlr_log(WLR_ERROR, "IPC Client on fd %d doesn't send IPC headers of version %d, it's likely older than cardboard", client.client_fd, libcardboard::ipc::PROTOCOL_VERSION);
+            return false;
+        }
+        libcardboard::ipc::Header header = *maybe_header;
 
-        std::copy(
-            client->message.begin(),
-            client->message.end(),
-            reinterpret_cast<char*>(buffer));
+        if (header.version != libcardboard::ipc::PROTOCOL_VERSION) {
+            wlr_log(WLR_ERROR, "IPC Client on fd %d speaks IPC protocol version %d instead of %d", client.client_fd, header.version, libcardboard::ipc::PROTOCOL_VERSION);
+            // the response carries our version, so the client can tell why it's disconnected
+            send_response(client, header.request_id, "Unsupported IPC protocol version");
+            return false;
+        }
 
-        ssize_t written = write(client->client_fd, buffer, client->message.empty() + header.size());
-        if (written == -1 && errno == EAGAIN) {
-            return 0;
+        if (header.incoming_bytes < 0 || header.incoming_bytes > libcardboard::ipc::MAX_PAYLOAD_SIZE) {
+            wlr_log(WLR_INFO, "IPC Client on fd %d sent a payload of invalid size %d", client.client_fd, header.incoming_bytes);
+            return false;
         }
 
-        if (written == -1) {
-            wlr_log(WLR_INFO, "Unable to send data to IPC client");
+        const size_t payload_size = header.incoming_bytes;
+        if (client.input_size - offset - libcardboard::ipc::HEADER_SIZE < payload_size) {
+            break;
+        }
+
+        client.response.clear();
+        read_command_data(client.input.data() + offset + libcardboard::ipc::HEADER_SIZE, payload_size)
+            .map([this, &client](const CommandData& command_data) {
+                if (std::holds_alternative<command_arguments::subscribe>(command_data)) {
+                    client.subscribed = true;
+                    return;
+                }
+                command_callback(command_data, client.response);
+            })
+            .map_error([&client](const std::string& error) {
+                wlr_log(WLR_INFO, "unable to parse command: %s", error.c_str());
+                client.response = "Unable to parse command: " + error;
+            });
+        offset += libcardboard::ipc::HEADER_SIZE + payload_size;
+
+        if (!send_response(client, header.request_id, client.response)) {
+            return false;
         }
     }
 
-    client->ipc->remove_client(client);
-    return 0;
+    // keep the incomplete message at the start of the buffer
+    std::copy(client.input.begin() + offset, client.input.begin() + client.input_size, client.input.begin());
+    client.input_size -= offset;
+    return true;
+}
+
+bool IPC::send_response(IPC::Client& client, uint32_t request_id, const std::string& message)
+{
+    libcardboard::ipc::AlignedHeaderBuffer header = libcardboard::ipc::create_header_buffer({
+        .incoming_bytes = static_cast<int>(message.size()),
+        .request_id = request_id,
+    });
+
+    size_t written = 0;
+    if (client.output.empty()) {
+        // nothing queued before it, so the response can go out without being copied
+        std::array<struct iovec, 2> iov = { {
+            { .iov_base = header.data(), .iov_len = header.size() },
+            { .iov_base = const_cast<char*>(message.data()), .iov_len = message.size() },
+        } };
+        ssize_t result = writev(client.client_fd, iov.data(), iov.size());
+        if (result == -1 && errno != EAGAIN && errno != EINTR) {
+            wlr_log(WLR_INFO, "Unable to send data to IPC client: %s", strerror(errno));
+            return false;
+        }
+        written = std::max<ssize_t>(result, 0);
+    }
+
+    // queue whatever the socket didn't take
+    const auto* message_bytes = reinterpret_cast<const std::byte*>(message.data());
+    if (written < header.size()) {
+        client.output.insert(client.output.end(), header.begin() + written, header.end());
+        client.output.insert(client.output.end(), message_bytes, message_bytes + message.size());
+    } else {
+        client.output.insert(client.output.end(), message_bytes + (written - header.size()), message_bytes + message.size());
+    }
+    watch_writable(client);
+
+    return true;
+}
+
+bool IPC::flush_responses(IPC::Client& client)
+{
+    if (!client.output.empty()) {
+        ssize_t written = write(client.client_fd, client.output.data() + client.output_offset, client.output.size() - client.output_offset);
+        if (written == -1 && errno != EAGAIN && errno != EINTR) {
+            wlr_log(WLR_INFO, "Unable to send data to IPC client: %s", strerror(errno));
+            return false;
+        }
+        client.output_offset += std::max<ssize_t>(written, 0);
+
+        // the written bytes are dropped at once when everything went out, else when they are the larger half,
+        // so that moving the rest to the front stays linear in the bytes written
+        if (client.output_offset == client.output.size()) {
+            client.output.clear();
+            client.output_offset = 0;
+        } else if (client.output_offset >= client.output.size() / 2) {
+            client.output.erase(client.output.begin(), client.output.begin() + client.output_offset);
+            client.output_offset = 0;
+        }
+    }
+
+    watch_writable(client);
+    return true;
+}
+
+void IPC::watch_writable(IPC::Client& client)
+{
+    if (!client.output.empty() && !client.writable_event_source) {
+        client.writable_event_source = wl_event_loop_add_fd(
+            server->event_loop,
+            client.client_fd,
+            WL_EVENT_WRITABLE,
+            IPC::handle_client_writeable,
+            &client);
+    } else if (client.output.empty() && client.writable_event_source) {
+        wl_event_source_remove(client.writable_event_source);
+        client.writable_event_source = nullptr;
+    }
+}
+
+void IPC::watch_readable(IPC::Client& client)
+{
+    if (client.closing) {
+        return;
+    }
+
+    const size_t backlog = client.output.size() - client.output_offset;
+    if (backlog > MAX_RESPONSE_BACKLOG && client.readable_event_source) {
+        wl_event_source_remove(client.readable_event_source);
+        client.readable_event_source = nullptr;
+    } else if (backlog <= MAX_RESPONSE_BACKLOG && !client.readable_event_source) {
+        client.readable_event_source = wl_event_loop_add_fd(
+            server->event_loop,
+            client.client_fd,
+            WL_EVENT_READABLE,
+            IPC::handle_client_readable,
+            &client);
+    }
+}
+
+/// Appends the framed \a event to \a output.
+static void append_event(std::vector<std::byte>& output, const libcardboard::ipc::Event& event, std::string& payload)
+{
+    payload.clear();
+    libcardboard::ipc::write_event(event, payload);
+
+    libcardboard::ipc::AlignedHeaderBuffer header = libcardboard::ipc::create_header_buffer({
+        .incoming_bytes = static_cast<int>(payload.size()),
+        .request_id = libcardboard::ipc::EVENT_REQUEST_ID,
+    });
+    const auto* payload_bytes = reinterpret_cast<const std::byte*>(payload.data());
+    output.insert(output.end(), header.begin(), header.end());
+    output.insert(output.end(), payload_bytes, payload_bytes + payload.size());
+}
+
+void IPC::broadcast_event(const libcardboard::ipc::Event& event)
+{
+    std::string payload;
+
+    for (auto& client : clients) {
+        if (!client.subscribed || client.closing) {
+            continue;
+        }
+
+        // nothing is written here: this may run while a command of this very client is being processed
+        const size_t needed = 2 * (libcardboard::ipc::HEADER_SIZE + libcardboard::ipc::EVENT_FIXED_SIZE) + event.output.size();
+        if (client.output.size() - client.output_offset + needed > MAX_EVENT_BACKLOG) {
+            client.dropped_events++;
+            continue;
+        }
+
+        if (client.dropped_events > 0) {
+            append_event(client.output,
+                         { .type = libcardboard::ipc::EventType::EventsDropped, .dropped = client.dropped_events },
+                         payload);
+            client.dropped_events = 0;
+        }
+        append_event(client.output, event, payload);
+        watch_writable(client);
+    }
+}
+
+void broadcast_event(Server& server, const libcardboard::ipc::Event& event)
+{
+    if (server.ipc) {
+        server.ipc->broadcast_event(event);
+    }
 }
 
 void IPC::remove_client(IPC::Client* client)
@@ -262,9 +400,6 @@ void IPC::remove_client(IPC::Client* client)
 
 IPC::Client::~Client()
 {
-    // shutdown routine for ipc client
-    shutdown(client_fd, SHUT_RDWR);
-
     if (readable_event_source) {
         wl_event_source_remove(readable_event_source);
     }
@@ -272,20 +407,30 @@ IPC::Client::~Client()
     if (writable_event_source) {
         wl_event_source_remove(writable_event_source);
     }
+
+    // shutdown routine for ipc client
+    if (client_fd != -1) {
+        shutdown(client_fd, SHUT_RDWR);
+        close(client_fd);
+    }
 }
 
 IPC::Client::Client(IPC::Client&& other) noexcept
     : ipc { other.ipc }
     , client_fd { other.client_fd }
-    , state { other.state }
     , readable_event_source { other.readable_event_source }
     , writable_event_source { other.writable_event_source }
-    , payload_size { other.payload_size }
-    , message { std::move(other.message) }
+    , input { std::move(other.input) }
+    , input_size { other.input_size }
+    , response { std::move(other.response) }
+    , output { std::move(other.output) }
+    , output_offset { other.output_offset }
+    , closing { other.closing }
+    , subscribed { other.subscribed }
+    , dropped_events { other.dropped_events }
 {
     other.ipc = nullptr;
-    other.client_fd = 0;
+    other.client_fd = -1;
     other.readable_event_source = nullptr;
     other.writable_event_source = nullptr;
-    other.payload_size = 0;
 }
@@ -1,13 +1,18 @@
 #ifndef CARDBOARD_IPC_H_INCLUDED
 #define CARDBOARD_IPC_H_INCLUDED
 
+#include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <optional>
 #include <string>
 #include <vector>
 
 #include <sys/un.h>
 
+#include <cardboard/command_protocol.h>
+#include <cardboard/ipc.h>
+
 #include "Listener.h"
 #include "NotNull.h"
 
@@ -26,35 +31,45 @@ struct Server;
 class IPC;
 using IPCInstance = std::unique_ptr<IPC>;
 
+/**
+ * \brief Runs a command received over IPC, writing its response to the string.
+ *
+ * The string is empty when the callback is called, and keeps its capacity from one command to the next.
+ */
+using CommandCallback = std::function<void(const CommandData&, std::string&)>;
+
 /**
  * \brief Manages all incoming client connections, communicating with them using the Cardboard IPC protocol
  */
 class IPC {
-    /**
-     * \brief describes the stage of the client-server protocol communication of a client
-     */
-    enum class ClientState {
-        READING_HEADER,
-        READING_PAYLOAD,
-        WRITING
-    };
-
     /**
      * \brief the state of a single client
+     *
+     * A client keeps its connection open and can pipeline any number of commands.
      */
     struct Client {
         IPC* ipc;
         int client_fd;
-        ClientState state;
         wl_event_source* readable_event_source = nullptr;
         wl_event_source* writable_event_source = nullptr;
-        int payload_size = 0;
-        std::string message {};
-
-        Client(IPC* ipc, int client_fd, ClientState state)
+        /// received bytes that don't form a complete message yet, in the first #input_size bytes
+        std::vector<std::byte> input {};
+        size_t input_size = 0;
+        /// the response to the command being run, reused from one command to the next
+        std::string response {};
+        /// framed responses that couldn't be written yet, from #output_offset on
+        std::vector<std::byte> output {};
+        size_t output_offset = 0;
+        /// the client closed its end, disconnect it once #output is written
+        bool closing = false;
+        /// the client ran the subscribe command and receives events
+        bool subscribed = false;
+        /// events discarded because #output was full, reported with the next event that fits
+        uint32_t dropped_events = 0;
+
+        Client(IPC* ipc, int client_fd)
             : ipc(ipc)
             , client_fd(client_fd)
-            , state(state)
         {
         }
         Client(const Client&) = delete;
@@ -72,7 +87,7 @@ private:
         Server* server,
         int socket_fd,
         std::unique_ptr<sockaddr_un>&& socket_address,
-        std::function<std::string(const CommandData&)>&& command_callback)
+        CommandCallback&& command_callback)
         : server { server }
         , socket_fd { socket_fd }
         , socket_address { std::move(socket_address) }
@@ -85,6 +100,34 @@ public:
     IPC(const IPC&) = delete;
     IPC(IPC&&) = default;
 
+    /**
+     * \brief Most bytes waiting to be written to a subscribed client before its events get dropped
+     *
+     * Subscribers that don't keep up lose events instead of making the compositor buffer without bounds.
+     */
+    static constexpr size_t MAX_EVENT_BACKLOG = 64 * 1024;
+
+    /**
+     * \brief Most bytes waiting to be written to a client before its commands stop being read
+     *
+     * Clients that pipeline commands without reading the responses are paused until they catch up,
+     * instead of making the compositor buffer without bounds.
+     */
+    static constexpr size_t MAX_RESPONSE_BACKLOG = 256 * 1024;
+
+    /**
+     * \brief How many bytes are received from a client at once
+     *
+     * The input buffer of a client grows when less than this is left after the bytes it holds,
+     * it never shrinks.
+     */
+    static constexpr size_t READ_CHUNK_SIZE = 16 * 1024;
+
+    /**
+     * \brief Queues \a event for every subscribed client. It is written once their socket is writable.
+     */
+    void broadcast_event(const libcardboard::ipc::Event& event);
+
 private:
     /**
      * \brief the callback wayland calls when a client is trying to connect
@@ -102,21 +145,51 @@ private:
     static int handle_client_writeable(int fd, uint32_t mask, void* data);
 
 private:
+    /**
+     * \brief runs every complete command in the input buffer of \a client and queues the responses
+     * \return false if the client sent a malformed message
+     */
+    bool process_commands(Client&);
+
+    /**
+     * \brief sends the response to a command, queueing the part the socket doesn't take right away
+     * \return false if the client is gone
+     */
+    bool send_response(Client&, uint32_t request_id, const std::string& message);
+
+    /**
+     * \brief writes as much of the queued responses of \a client as the socket takes,
+     * waiting for the socket to become writable if some are left
+     * \return false if the client is gone
+     */
+    bool flush_responses(Client&);
+
     /**
      * \brief removes a client from the clients list - thus disconnecting it as well
      */
     void remove_client(Client*);
 
+    /**
+     * \brief makes sure the writable event source of \a client is registered if it has pending output
+     */
+    void watch_writable(Client&);
+
+    /**
+     * \brief stops reading the commands of \a client while its responses exceed #MAX_RESPONSE_BACKLOG,
+     * and resumes once they are written
+     */
+    void watch_readable(Client&);
+
 private:
     ListenerList ipc_listeners;
     NotNullPointer<Server> server;
     int socket_fd;
     std::unique_ptr<sockaddr_un> socket_address;
-    std::function<std::string(CommandData)> command_callback;
+    CommandCallback command_callback;
 
     std::list<Client> clients;
 
-    friend std::optional<IPCInstance> create_ipc(Server& server, const std::string& socket_path, std::function<std::string(const CommandData&)> command_callback);
+    friend std::optional<IPCInstance> create_ipc(Server& server, const std::string& socket_path, CommandCallback command_callback);
 };
 
 /**
@@ -126,6 +199,11 @@ private:
  * \param command_callback callable that will be called when a command will be received
  * \return returns the newly created IPC instance
  */
-std::optional<IPCInstance> create_ipc(Server& server, const std::string& socket_path, std::function<std::string(const CommandData&)> command_callback);
+std::optional<IPCInstance> create_ipc(Server& server, const std::string& socket_path, CommandCallback command_callback);
+
+/**
+ * \brief Sends \a event to the IPC clients that subscribed to events, if IPC is running
+ */
+void broadcast_event(Server& server, const libcardboard::ipc::Event& event);
 
 #endif // CARDBOARD_IPC_H_INCLUDED
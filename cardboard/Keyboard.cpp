@@ -9,6 +9,85 @@ extern "C" {
 #include "Keyboard.h"
 #include "Server.h"
 
+std::pair<KeybindingTable::Binding*, bool> KeybindingTable::insert(KeyCombo combo)
+{
+    uint64_t key = make_key(combo);
+
+    auto it = std::lower_bound(keys.begin(), keys.end(), key);
+    if (it != keys.end() && *it == key) {
+        return { &bindings[indices[it - keys.begin()]], false };
+    }
+
+    auto position = it - keys.begin();
+    keys.insert(it, key);
+    indices.insert(indices.begin() + position, static_cast<uint32_t>(bindings.size()));
+    bindings.emplace_back();
+
+    return { &bindings.back(), true };
+}
+
+KeybindingsConfig::KeybindingsConfig()
+{
+    tables.emplace_back();
+    modes.push_back({ std::string { DEFAULT_MODE }, 0 });
+}
+
+std::optional<std::string> KeybindingsConfig::bind(std::string_view mode, std::span<const KeyCombo> keys, Command command, bool locked)
+{
+    if (keys.empty()) {
+        return "no keys to bind";
+    }
+
+    auto mode_it = std::find_if(modes.begin(), modes.end(), [mode](const Mode& m) { return m.name == mode; });
+    if (mode_it == modes.end()) {
+        tables.emplace_back();
+        mode_it = modes.insert(modes.end(), { std::string { mode }, tables.size() - 1 });
+    }
+
+    size_t table = mode_it->table;
+    for (size_t i = 0; i + 1 < keys.size(); i++) {
+        auto [binding, added] = tables[table].insert(keys[i]);
+        if (added) {
+            tables.emplace_back();
+            binding->chord = tables.size() - 1;
+        } else if (!binding->chord) {
+            return "the beginning of the chord is already bound to a command";
+        }
+        table = *binding->chord;
+    }
+
+    auto [binding, added] = tables[table].insert(keys.back());
+    if (added) {
+        binding->command = std::move(command);
+        binding->locked = locked;
+    } else if (binding->chord) {
+        return "the keys already start a chord";
+    }
+
+    return std::nullopt;
+}
+
+bool KeybindingsConfig::set_mode(std::string_view mode)
+{
+    auto mode_it = std::find_if(modes.begin(), modes.end(), [mode](const Mode& m) { return m.name == mode; });
+    if (mode_it == modes.end()) {
+        return false;
+    }
+
+    current_mode = mode_it - modes.begin();
+    end_chord();
+    return true;
+}
+
+/// Returns true if \a sym is the keysym of a modifier key, which doesn't interrupt a chord.
+static bool is_modifier_keysym(xkb_keysym_t sym)
+{
+    return (sym >= XKB_KEY_Shift_L && sym <= XKB_KEY_Hyper_R)
+        || (sym >= XKB_KEY_ISO_Lock && sym <= XKB_KEY_ISO_Level5_Lock)
+        || sym == XKB_KEY_Mode_switch
+        || sym == XKB_KEY_Num_Lock;
+}
+
 void KeyboardHandleData::destroy_handler(struct wl_listener* listener, void*)
 {
     auto* server = get_server(listener);
@@ -47,16 +126,46 @@ void KeyboardHandleData::key_handler(struct wl_listener* listener, void* data)
             event->keycode + 8,
             &syms);
 
-        // TODO: keybinds that work when there is an exclusive client
-        if (!handle_data.seat->exclusive_client) {
-            for (int i = 0; i < syms_number; i++) {
-                auto& map = handle_data.config->map[modifiers];
-                // as you can see below, keysyms are always stored lowercase
-                if (auto it = map.find(xkb_keysym_to_lower(syms[i])); it != map.end()) {
-                    (it->second)(server);
-                    handled = true;
-                }
+        auto& config = *handle_data.config;
+        bool locked = handle_data.seat->exclusive_client.has_value();
+        if (locked) {
+            config.end_chord();
+        }
+
+        bool in_chord = config.in_chord();
+        bool only_modifiers = true;
+
+        for (int i = 0; i < syms_number; i++) {
+            only_modifiers = only_modifiers && is_modifier_keysym(syms[i]);
+
+            // as you can see below, keysyms are always stored lowercase
+            const auto* binding = config.find({ modifiers, xkb_keysym_to_lower(syms[i]) });
+            // with an exclusive client, like a lock screen, only the bindings flagged as locked run, and chords don't start
+            if (!binding || (locked && (binding->chord || !binding->locked))) {
+                continue;
+            }
+
+            handled = true;
+            if (binding->chord) {
+                config.continue_chord(*binding);
+                break;
             }
+
+            // the command may switch modes, end the chord before
+            config.end_chord();
+            (binding->command)(server);
+
+            // every keysym that matches a binding runs its command, except for the last key of a chord,
+            // which only completes that chord
+            if (in_chord) {
+                break;
+            }
+        }
+
+        // a key that doesn't continue the chord cancels it, and goes nowhere
+        if (in_chord && !handled && !only_modifiers) {
+            config.end_chord();
+            handled = true;
         }
 
         // VT changing works even when there is an exclusive client,
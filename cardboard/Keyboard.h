@@ -6,7 +6,15 @@ extern "C" {
 #include <wlr/types/wlr_input_device.h>
 }
 
-#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 #include "Command.h"
 #include "NotNull.h"
@@ -30,6 +38,86 @@ private:
     friend struct Seat;
 };
 
+/// A key pressed together with modifiers: a mod mask and the lowercase variant of a keysym.
+struct KeyCombo {
+    uint32_t modifiers;
+    xkb_keysym_t keysym;
+};
+
+/**
+ * \brief A table of key bindings, sorted for fast lookups.
+ *
+ * A key combination is bound either to a command or, when it starts a chord,
+ * to the table of the key combinations that can follow it.
+ */
+struct KeybindingTable {
+    static_assert(WLR_MODIFIER_COUNT <= 12, "too many modifiers");
+
+    struct Binding {
+        Command command;
+        /// Index of the table of the next keys in the chord, in KeybindingsConfig, if the binding starts a chord.
+        std::optional<size_t> chord;
+        /// The command also runs when a client holds the input exclusively, like a lock screen does.
+        bool locked = false;
+    };
+
+    /**
+     * \brief Returns the binding of \a combo, adding an empty one if there is none.
+     *
+     * The second member of the pair is true if the binding has been added.
+     */
+    std::pair<Binding*, bool> insert(KeyCombo combo);
+
+    /**
+     * \brief Returns the binding of \a combo, if there is one.
+     *
+     * \attention The \c keysym \b must be the lowercase variant! Key bindings containing uppercase characters
+     * will have the shift mod mask set.
+     *
+     * For example, to retrieve the IPC command for the <tt>super + shift + x</tt> binding:
+     *
+     * \code{.cpp}
+     * find({ WLR_MODIFIER_LOGO | WLR_MODIFIER_SHIFT, XKB_KEY_x })->command // notice the lowercase `x`
+     * \endcode
+     */
+    const Binding* find(KeyCombo combo) const
+    {
+        uint64_t key = make_key(combo);
+
+        // a binary search over a few cache lines, this runs for every keysym of every key press
+        auto it = std::lower_bound(keys.begin(), keys.end(), key);
+        if (it != keys.end() && *it == key) {
+            return &bindings[indices[it - keys.begin()]];
+        }
+        return nullptr;
+    }
+
+    /// Number of key bindings, including chord prefixes.
+    size_t size() const { return keys.size(); }
+
+private:
+    static uint64_t make_key(KeyCombo combo)
+    {
+        return (static_cast<uint64_t>(combo.modifiers) << 32) | combo.keysym;
+    }
+
+    /**
+     * \brief Sorted (mod mask, keysym) pairs of every key binding, packed in one integer each.
+     *
+     * The keys are kept apart from the bindings so that a lookup only touches the bindings
+     * when the key press matches.
+     */
+    std::vector<uint64_t> keys;
+    /// Index in \a bindings of each key, in the same order as \a keys.
+    std::vector<uint32_t> indices;
+    /**
+     * \brief The bindings, in the order they were added.
+     *
+     * A deque doesn't move its elements when it grows, so a running command can add key bindings.
+     */
+    std::deque<Binding> bindings;
+};
+
 /**
  * \brief This structure holds the configured key bindings.
  *
@@ -47,28 +135,89 @@ private:
  * \code{.sh}
  * cutter exec terminal
  * \endcode
+ *
+ * A key binding can also be a chord, a sequence of key combinations pressed one after another,
+ * separated by commas:
+ *
+ * \code{.sh}
+ * cutter bind super+w,h focus left
+ * \endcode
+ *
+ * Key bindings belong to a mode, and only the bindings of the current mode are active. Bindings
+ * go to the \c default mode, unless another mode is given. Modes are created by binding keys in them,
+ * and switched to with the \c mode command:
+ *
+ * \code{.sh}
+ * cutter bind super+r mode resize
+ * cutter bind --mode resize l resize 20 0
+ * cutter bind --mode resize escape mode default
+ * \endcode
+ *
+ * While a client holds the input exclusively, like a lock screen, only the bindings made with
+ * \c --locked work:
+ *
+ * \code{.sh}
+ * cutter bind --locked xf86audioraisevolume exec pactl set-sink-volume @DEFAULT_SINK@ +5%
+ * \endcode
  */
 struct KeybindingsConfig {
-    static_assert(WLR_MODIFIER_COUNT <= 12, "too many modifiers");
+    static constexpr std::string_view DEFAULT_MODE = "default";
+
+    KeybindingsConfig();
 
     /**
-     * \brief An array of key binding maps, for each modifier combination.
-     *
-     * The array index is the mod mask of the key binding.
+     * \brief Binds \a command to pressing \a keys one after another, in \a mode.
      *
-     * They key of each map is the lowercase variant of the keysym, and the value is
-     * a pair of an IPC command handler and its arguments.
+     * If the key sequence is already bound, the existing binding is kept.
+     * With \a locked, the binding works even when a client holds the input exclusively,
+     * which chords never do.
      *
-     * \attention The \c keysym \b must be the lowercase variant! Key bindings containing uppercase characters
-     * will have the shift mod mask set.
+     * \return an error message if a part of \a keys is bound to a command,
+     * or if \a keys start a longer chord.
+     */
+    std::optional<std::string> bind(std::string_view mode, std::span<const KeyCombo> keys, Command command, bool locked = false);
+
+    /**
+     * \brief Switches to \a mode and cancels the chord in progress.
      *
-     * For example, to retrieve the IPC command for the <tt>super + shift + x</tt> binding:
+     * \return false if there is no such mode
+     */
+    bool set_mode(std::string_view mode);
+
+    /// Name of the current mode.
+    const std::string& get_mode() const { return modes[current_mode].name; }
+
+    /**
+     * \brief Returns the binding of \a combo among the keys that can be pressed now, if there is one.
      *
-     * \code{.cpp}
-     * map[WLR_MODIFIER_LOGO | WLR_MODIFIER_SHIFT][XKB_KEY_x] // notice the lowercase `x`
-     * \endcode
+     * These are the bindings of the current mode, or the next keys of the chord in progress.
      */
-    std::unordered_map<xkb_keysym_t, Command> map[(1 << WLR_MODIFIER_COUNT) - 1];
+    const KeybindingTable::Binding* find(KeyCombo combo) const
+    {
+        return tables[current_table].find(combo);
+    }
+
+    /// Returns true if the first keys of a chord have been pressed.
+    bool in_chord() const { return current_table != modes[current_mode].table; }
+
+    /// Waits for the keys in \a binding's table, which must start a chord.
+    void continue_chord(const KeybindingTable::Binding& binding) { current_table = *binding.chord; }
+
+    /// Goes back to the bindings of the current mode.
+    void end_chord() { current_table = modes[current_mode].table; }
+
+private:
+    struct Mode {
+        std::string name;
+        size_t table; ///< Index of the table of the mode in \a tables
+    };
+
+    std::vector<Mode> modes;
+    /// Tables of every mode and chord. Like KeybindingTable's bindings, they don't move when a table is added.
+    std::deque<KeybindingTable> tables;
+    size_t current_mode = 0;
+    /// Table to look the next key press up in
+    size_t current_table = 0;
 };
 
 /**
@@ -24,6 +24,7 @@ static void create_layer_popup(Server& server, NotNullPointer<struct wlr_xdg_pop
                           { &popup->wlr_popup->base->events.destroy, &LayerSurfacePopup::destroy_handler },
                           { &popup->wlr_popup->base->events.new_popup, &LayerSurfacePopup::new_popup_handler },
                           { &popup->wlr_popup->base->events.map, &LayerSurfacePopup::map_handler },
+                          { &popup->wlr_popup->base->events.unmap, &LayerSurfacePopup::unmap_handler },
                       });
 
     popup->unconstrain(*(server.output_manager));
@@ -224,6 +225,9 @@ static void arrange_layer(Output& output, LayerArray::value_type& layer_surfaces
             continue;
         }
 
+        if (memcmp(&box, &layer_surface.geometry, sizeof(struct wlr_box)) != 0) {
+            output_damage_whole(output);
+        }
         layer_surface.geometry = box;
         apply_exclusive_zone(usable_area, state);
         wlr_layer_surface_v1_configure(layer_surface.surface, box.width, box.height);
@@ -338,6 +342,9 @@ void LayerSurface::unmap_handler(struct wl_listener* listener, void*)
     if (server->seat.focused_layer == layer_surface->surface) {
         server->seat.focus_layer(*server, nullptr);
     }
+    layer_surface->output.and_then([](auto& output) {
+        output_damage_whole(output);
+    });
     //server->seat.cursor.rebase(server);
 }
 
@@ -412,3 +419,12 @@ void LayerSurfacePopup::map_handler(struct wl_listener* listener, void*)
 
     wlr_surface_send_enter(popup->wlr_popup->base->surface, popup->parent->surface->output);
 }
+
+void LayerSurfacePopup::unmap_handler(struct wl_listener* listener, void*)
+{
+    auto* popup = get_listener_data<LayerSurfacePopup*>(listener);
+
+    popup->parent->output.and_then([](auto& output) {
+        output_damage_whole(output);
+    });
+}
@@ -49,6 +49,7 @@ struct LayerSurfacePopup {
     static void destroy_handler(struct wl_listener* listener, void* data);
     static void new_popup_handler(struct wl_listener* listener, void* data);
     static void map_handler(struct wl_listener* listener, void* data);
+    static void unmap_handler(struct wl_listener* listener, void* data);
 };
 
 using LayerArray = std::array<std::list<LayerSurface>, 4>;
@@ -42,7 +42,8 @@ using ListenerData = std::variant<
     XwaylandORSurface*,
 #endif
     XDGView*,
-    XDGPopup*>;
+    XDGPopup*,
+    struct wlr_surface*>;
 
 /**
  * \brief The Listener is a wrapper around Wayland's \c wl_listener concept.
@@ -7,27 +7,39 @@ extern "C" {
 #include <wlr/render/wlr_renderer.h>
 #include <wlr/types/wlr_matrix.h>
 #undef static
+#include <wlr/types/wlr_output_damage.h>
 #include <wlr/types/wlr_output_layout.h>
+#include <wlr/util/region.h>
 }
 
+#include <pixman.h>
+
+#include <algorithm>
 #include <array>
+#include <chrono>
+#include <cmath>
 #include <ctime>
+#include <span>
 #include <wlr/types/wlr_output.h>
 
 #include "Helpers.h"
 #include "Listener.h"
 #include "Output.h"
 #include "Server.h"
+#include "XDGView.h"
 #if HAVE_XWAYLAND
 #include "Xwayland.h"
 #endif
 
 struct RenderData {
     struct wlr_output* output;
-    struct wlr_renderer* renderer;
+    /// The list the surfaces are appended to.
+    std::vector<RenderItem>* render_list;
     int lx, ly;
     const struct timespec* when;
     Server* server;
+    /// The view the surfaces belong to, if any, whose toplevel surface matrix is cached.
+    View* view = nullptr;
 };
 
 void register_output(Server& server, Output&& output_)
@@ -39,13 +51,309 @@ void register_output(Server& server, Output&& output_)
     register_handlers(server,
                       &output,
                       {
-                          { &output.wlr_output->events.frame, Output::frame_handler },
                           { &output.wlr_output->events.present, Output::present_handler },
                           { &output.wlr_output->events.mode, Output::mode_handler },
                           { &output.wlr_output->events.transform, Output::transform_handler },
                           { &output.wlr_output->events.scale, Output::scale_handler },
                           { &output.wlr_output->events.destroy, Output::destroy_handler },
                       });
+
+    // the damage tracker destroys itself together with the output, after our destroy handler
+    // has run and removed the frame listener
+    output.damage = wlr_output_damage_create(output.wlr_output);
+    register_handlers(server, &output, { { &output.damage->events.frame, Output::frame_handler } });
+}
+
+/// Converts \a box from output layout coordinates to the buffer coordinates of \a output, rounding outwards.
+static struct wlr_box layout_box_to_output(Server& server, Output& output, const struct wlr_box& box)
+{
+    const struct wlr_box* output_box = server.output_manager->get_output_box(output);
+    const float scale = output.wlr_output->scale;
+
+    int x1 = static_cast<int>(std::floor((box.x - output_box->x) * scale));
+    int y1 = static_cast<int>(std::floor((box.y - output_box->y) * scale));
+    int x2 = static_cast<int>(std::ceil((box.x + box.width - output_box->x) * scale));
+    int y2 = static_cast<int>(std::ceil((box.y + box.height - output_box->y) * scale));
+
+    return { .x = x1, .y = y1, .width = x2 - x1, .height = y2 - y1 };
+}
+
+/// Damages \a box, given in output buffer coordinates. A frame is scheduled only if the box is on the output.
+static void damage_output_box(Output& output, const struct wlr_box& box)
+{
+    struct wlr_box output_box = {};
+    wlr_output_transformed_resolution(output.wlr_output, &output_box.width, &output_box.height);
+    struct wlr_box intersection;
+    if (!wlr_box_intersection(&intersection, &box, &output_box)) {
+        return;
+    }
+
+    pixman_region32_t damage;
+    pixman_region32_init_rect(&damage, intersection.x, intersection.y, intersection.width, intersection.height);
+    wlr_output_damage_add(output.damage, &damage);
+    pixman_region32_fini(&damage);
+}
+
+struct DamageData {
+    Server* server;
+    Output* output;
+    /// If not null, only this surface of the iterated surface tree is damaged.
+    struct wlr_surface* target;
+    int lx, ly;
+    bool whole;
+    bool found;
+};
+
+static void damage_surface_iterator(struct wlr_surface* surface, int sx, int sy, void* data)
+{
+    auto* ddata = static_cast<DamageData*>(data);
+    if (ddata->target != nullptr && ddata->target != surface) {
+        return;
+    }
+    ddata->found = true;
+
+    struct wlr_output* wlr_output = ddata->output->wlr_output;
+    struct wlr_box box = layout_box_to_output(*ddata->server,
+                                              *ddata->output,
+                                              {
+                                                  .x = ddata->lx + sx,
+                                                  .y = ddata->ly + sy,
+                                                  .width = surface->current.width,
+                                                  .height = surface->current.height,
+                                              });
+
+    if (ddata->whole) {
+        damage_output_box(*ddata->output, box);
+        return;
+    }
+
+    pixman_region32_t damage;
+    pixman_region32_init(&damage);
+    wlr_surface_get_effective_damage(surface, &damage);
+    wlr_region_scale(&damage, &damage, wlr_output->scale);
+    if (std::ceil(wlr_output->scale) > surface->current.scale) {
+        // the buffer is upscaled, so the filtering bleeds into the neighbouring pixels
+        wlr_region_expand(&damage, &damage, std::ceil(wlr_output->scale) - surface->current.scale);
+    }
+    pixman_region32_translate(&damage, box.x, box.y);
+    wlr_output_damage_add(ddata->output->damage, &damage);
+    pixman_region32_fini(&damage);
+
+    // a commit without new content may still wait for a frame callback
+    struct wlr_box output_box = {};
+    wlr_output_transformed_resolution(wlr_output, &output_box.width, &output_box.height);
+    struct wlr_box intersection;
+    if (wlr_box_intersection(&intersection, &box, &output_box)) {
+        output_schedule_frame(*ddata->output);
+    }
+}
+
+void output_schedule_frame(Output& output)
+{
+    wlr_output_schedule_frame(output.wlr_output);
+}
+
+void output_damage_whole(Output& output)
+{
+    wlr_output_damage_add_whole(output.damage);
+}
+
+void output_damage_box(Server& server, Output& output, struct wlr_box box)
+{
+    damage_output_box(output, layout_box_to_output(server, output, box));
+}
+
+void output_damage_view(Server& server, View& view, bool whole)
+{
+    if (!view.mapped) {
+        return;
+    }
+
+    view.get_views_output(server).and_then([&server, &view, whole](auto& output) {
+        DamageData ddata = {
+            .server = &server,
+            .output = &output,
+            .target = nullptr,
+            .lx = view.x,
+            .ly = view.y,
+            .whole = whole,
+            .found = false,
+        };
+        view.for_each_surface(damage_surface_iterator, &ddata);
+
+        if (whole) {
+            // the focus border is drawn in the gap around the view
+            const int gap = server.config.gap;
+            output_damage_box(server,
+                              output,
+                              {
+                                  .x = view.x + view.geometry.x - gap,
+                                  .y = view.y + view.geometry.y - gap,
+                                  .width = std::max(view.geometry.width, view.target_width) + 2 * gap,
+                                  .height = std::max(view.geometry.height, view.target_height) + 2 * gap,
+                              });
+        }
+    });
+}
+
+/// What a surface tree belongs to: a view, a layer surface or, if both are null, possibly an Xwayland unmanaged surface.
+struct SurfaceOwner {
+    View* view = nullptr;
+    LayerSurface* layer_surface = nullptr;
+};
+
+/// Finds the owner of \a surface by walking up its parents: subsurfaces and popups.
+static SurfaceOwner find_surface_owner(struct wlr_surface* surface)
+{
+    while (surface != nullptr) {
+        if (wlr_surface_is_subsurface(surface)) {
+            surface = wlr_subsurface_from_wlr_surface(surface)->parent;
+        } else if (wlr_surface_is_xdg_surface(surface)) {
+            struct wlr_xdg_surface* xdg_surface = wlr_xdg_surface_from_wlr_surface(surface);
+            if (xdg_surface->role != WLR_XDG_SURFACE_ROLE_POPUP) {
+                // set by the XDGView of toplevels
+                return { .view = static_cast<XDGView*>(xdg_surface->data) };
+            }
+            surface = xdg_surface->popup->parent;
+        } else if (wlr_surface_is_layer_surface(surface)) {
+            return { .layer_surface = static_cast<LayerSurface*>(wlr_layer_surface_v1_from_wlr_surface(surface)->data) };
+        }
+#if HAVE_XWAYLAND
+        else if (wlr_surface_is_xwayland_surface(surface)) {
+            struct wlr_xwayland_surface* xwayland_surface = wlr_xwayland_surface_from_wlr_surface(surface);
+            if (xwayland_surface->override_redirect) {
+                return {};
+            }
+            return { .view = static_cast<XwaylandView*>(xwayland_surface->data) };
+        }
+#endif
+        else {
+            return {};
+        }
+    }
+
+    return {};
+}
+
+void damage_surface(Server& server, struct wlr_surface* surface)
+{
+    auto owner = find_surface_owner(surface);
+
+    if (owner.view != nullptr) {
+        View* view = owner.view;
+        auto output = view->get_views_output(server);
+        if (!view->mapped || !output) {
+            return;
+        }
+
+        DamageData ddata = {
+            .server = &server,
+            .output = output.raw_pointer(),
+            .target = surface,
+            .lx = view->x,
+            .ly = view->y,
+            .whole = false,
+            .found = false,
+        };
+        view->for_each_surface(damage_surface_iterator, &ddata);
+        return;
+    }
+
+    if (owner.layer_surface != nullptr) {
+        auto& layer_surface = *owner.layer_surface;
+        if (!layer_surface.surface->mapped || !layer_surface.output) {
+            return;
+        }
+
+        auto& output = layer_surface.output.unwrap();
+        const struct wlr_box* output_box = server.output_manager->get_output_box(output);
+        DamageData ddata = {
+            .server = &server,
+            .output = &output,
+            .target = surface,
+            .lx = layer_surface.geometry.x + output_box->x,
+            .ly = layer_surface.geometry.y + output_box->y,
+            .whole = false,
+            .found = false,
+        };
+        wlr_layer_surface_v1_for_each_surface(layer_surface.surface, damage_surface_iterator, &ddata);
+        return;
+    }
+
+#if HAVE_XWAYLAND
+    // there are few of them, menus and tooltips
+    for (const auto& xwayland_or_surface : server.surface_manager.xwayland_or_surfaces) {
+        if (!xwayland_or_surface->mapped || !xwayland_or_surface->xwayland_surface->surface) {
+            continue;
+        }
+
+        // unmanaged surfaces are drawn on every output
+        bool found = false;
+        for (auto& output : server.output_manager->outputs) {
+            DamageData ddata = {
+                .server = &server,
+                .output = &output,
+                .target = surface,
+                .lx = xwayland_or_surface->lx,
+                .ly = xwayland_or_surface->ly,
+                .whole = false,
+                .found = false,
+            };
+            wlr_surface_for_each_surface(xwayland_or_surface->xwayland_surface->surface, damage_surface_iterator, &ddata);
+            found = ddata.found;
+        }
+        if (found) {
+            return;
+        }
+    }
+#endif
+}
+
+void damage_all_outputs(Server& server)
+{
+    for (auto& output : server.output_manager->outputs) {
+        output_damage_whole(output);
+    }
+}
+
+/// Restricts rendering to \a rect, given in output buffer coordinates before applying the output transform.
+static void scissor_output(struct wlr_output* wlr_output, struct wlr_renderer* renderer, const pixman_box32_t& rect)
+{
+    struct wlr_box box = {
+        .x = rect.x1,
+        .y = rect.y1,
+        .width = rect.x2 - rect.x1,
+        .height = rect.y2 - rect.y1,
+    };
+
+    int width, height;
+    wlr_output_transformed_resolution(wlr_output, &width, &height);
+    enum wl_output_transform transform = wlr_output_transform_invert(wlr_output->transform);
+    wlr_box_transform(&box, &box, transform, width, height);
+
+    wlr_renderer_scissor(renderer, &box);
+}
+
+/// Calls \a render for every damaged rectangle that \a box overlaps, with the scissor set to that rectangle.
+template <typename F>
+static void render_damaged(struct wlr_output* wlr_output, struct wlr_renderer* renderer, pixman_region32_t* output_damage, const struct wlr_box& box, F&& render)
+{
+    if (box.width <= 0 || box.height <= 0) {
+        return;
+    }
+
+    pixman_region32_t damage;
+    pixman_region32_init_rect(&damage, box.x, box.y, box.width, box.height);
+    pixman_region32_intersect(&damage, &damage, output_damage);
+
+    int rects_number;
+    pixman_box32_t* rects = pixman_region32_rectangles(&damage, &rects_number);
+    for (int i = 0; i < rects_number; i++) {
+        scissor_output(wlr_output, renderer, rects[i]);
+        render();
+    }
+
+    pixman_region32_fini(&damage);
 }
 
 /// Arrange the workspace associated with \a output.
@@ -58,6 +366,22 @@ static void arrange_output(Server& server, Output& output)
     ws_it->arrange_workspace(*(server.output_manager));
 }
 
+/// Returns the matrix projecting \a box on \a output, computed again only if its inputs changed since it was cached in \a cache.
+static const std::array<float, 9>& project_box_cached(View::RenderMatrixCache& cache, const struct wlr_box& box, enum wl_output_transform transform, struct wlr_output* output)
+{
+    if (cache.box.x != box.x || cache.box.y != box.y || cache.box.width != box.width || cache.box.height != box.height
+        || cache.transform != transform
+        || !std::equal(cache.output_transform_matrix.begin(), cache.output_transform_matrix.end(), output->transform_matrix)) {
+        cache.box = box;
+        cache.transform = transform;
+        std::copy(output->transform_matrix, output->transform_matrix + 9, cache.output_transform_matrix.begin());
+        wlr_matrix_project_box(cache.matrix.data(), &box, transform, 0, output->transform_matrix);
+    }
+
+    return cache.matrix;
+}
+
+/// Appends \a surface to the render list of the frame, if it's on the output.
 static void render_surface(struct wlr_surface* surface, int sx, int sy, void* data)
 {
     auto* rdata = static_cast<RenderData*>(data);
@@ -81,60 +405,173 @@ static void render_surface(struct wlr_surface* surface, int sx, int sy, void* da
         .height = static_cast<int>(surface->current.height * output->scale),
     };
 
+    // popups and floating views aren't culled before, so check again.
+    // off-screen surfaces get their frame callbacks from Server::hidden_frame_done_handler
+    struct wlr_box output_box = { .x = 0, .y = 0, .width = 0, .height = 0 };
+    wlr_output_transformed_resolution(output, &output_box.width, &output_box.height);
+    if (struct wlr_box intersection; !wlr_box_intersection(&intersection, &box, &output_box)) {
+        if (server->stats) {
+            server->stats->culled_surfaces++;
+        }
+        return;
+    }
+
+    auto& item = rdata->render_list->emplace_back();
+    item.box = box;
+    item.texture = texture;
+    item.surface = surface;
+
     // project box on ortographic projection
-    std::array<float, 9> matrix;
     enum wl_output_transform transform = wlr_output_transform_invert(surface->current.transform);
-    wlr_matrix_project_box(matrix.data(), &box, transform, 0, output->transform_matrix);
+    if (rdata->view != nullptr && surface == rdata->view->get_surface()) {
+        item.matrix = project_box_cached(rdata->view->render_matrix_cache, box, transform, output);
+    } else {
+        wlr_matrix_project_box(item.matrix.data(), &box, transform, 0, output->transform_matrix);
+    }
 
-    wlr_render_texture_with_matrix(rdata->renderer, texture, matrix.data(), 1);
     wlr_surface_send_frame_done(surface, rdata->when);
+    if (auto it = server->surfaces_shown.find(surface); it != server->surfaces_shown.end()) {
+        it->second = true;
+    }
+
+    if (server->stats) {
+        server->stats->rendered_surfaces++;
+    }
 }
 
-static void render_workspace(Server& server, Workspace& ws, struct wlr_output* wlr_output, struct wlr_renderer* renderer, struct timespec* now)
+/// Draws the items of \a render_list in order, clipped to \a damage.
+static void submit_render_list(struct wlr_output* wlr_output, struct wlr_renderer* renderer, pixman_region32_t* damage, std::span<const RenderItem> render_list)
 {
-    auto focused_view = server.seat.get_focused_view();
+    for (const auto& item : render_list) {
+        render_damaged(wlr_output, renderer, damage, item.box, [renderer, &item]() {
+            if (item.texture != nullptr) {
+                wlr_render_texture_with_matrix(renderer, item.texture, item.matrix.data(), 1);
+            } else {
+                wlr_render_quad_with_matrix(renderer, item.color.data(), item.matrix.data());
+            }
+        });
+    }
+}
 
-    bool focused_tiled = false;
+/**
+ * \brief Stands in for render_surface for the surfaces that aren't drawn because they can't be seen.
+ *
+ * They get their frame callbacks from Server::hidden_frame_done_handler instead, at a much lower rate.
+ */
+static void culled_surface_iterator(struct wlr_surface*, int, int, void* data)
+{
+    auto* rdata = static_cast<RenderData*>(data);
+
+    if (rdata->server->stats) {
+        rdata->server->stats->culled_surfaces++;
+    }
+}
+
+/// Returns true if the box of \a view, including the part of its surface outside its geometry, overlaps \a output_box.
+static bool view_intersects_box(View& view, const struct wlr_box& output_box)
+{
+    struct wlr_box box = {
+        .x = view.x + std::min(view.geometry.x, 0),
+        .y = view.y + std::min(view.geometry.y, 0),
+        .width = std::max(view.geometry.x + view.geometry.width, view.get_surface()->current.width) - std::min(view.geometry.x, 0),
+        .height = std::max(view.geometry.y + view.geometry.height, view.get_surface()->current.height) - std::min(view.geometry.y, 0),
+    };
+
+    struct wlr_box intersection;
+    return wlr_box_intersection(&intersection, &box, &output_box);
+}
+
+/**
+ * \brief Returns true if the fullscreen view of \a ws hides everything below it on \a output.
+ *
+ * That is when its surface covers the output and is opaque. Views can still be drawn over it,
+ * like the focused view.
+ */
+static bool fullscreen_view_occludes_output(Server& server, Workspace& ws, Output& output)
+{
+    if (!ws.fullscreen_view) {
+        return false;
+    }
+
+    View& view = ws.fullscreen_view.unwrap();
+    struct wlr_surface* surface = view.get_surface();
+    if (!view.mapped || surface == nullptr || !wlr_surface_has_buffer(surface)) {
+        return false;
+    }
+
+    const struct wlr_box* output_box = server.output_manager->get_output_box(output);
+    if (view.x > output_box->x || view.y > output_box->y
+        || view.x + surface->current.width < output_box->x + output_box->width
+        || view.y + surface->current.height < output_box->y + output_box->height) {
+        return false;
+    }
+
+    pixman_box32_t surface_box = { 0, 0, surface->current.width, surface->current.height };
+    return pixman_region32_contains_rectangle(&surface->opaque_region, &surface_box) == PIXMAN_REGION_IN;
+}
+
+static void render_workspace(Server& server, Workspace& ws, Output& output, std::vector<RenderItem>& render_list, struct timespec* now)
+{
+    const struct wlr_box* output_box = server.output_manager->get_output_box(output);
+
+    // the focused view is drawn over the other tiles, even over the fullscreen view
+    auto top_view = server.seat.get_focused_view();
+    // an opaque fullscreen view hides the tiles drawn before it, but not the ones after it
+    bool occluded = fullscreen_view_occludes_output(server, ws, output);
+
+    bool top_tiled = false;
     for (const auto& column : ws.columns) {
         for (const auto& tile : column.tiles) {
             if (!tile.view->mapped) {
                 continue;
             }
 
-            if (tile.view == focused_view.raw_pointer()) {
-                focused_tiled = true;
+            if (tile.view == top_view.raw_pointer()) {
+                top_tiled = true;
                 continue;
             }
 
+            if (tile.view == ws.fullscreen_view.raw_pointer()) {
+                occluded = false;
+            }
+
             RenderData rdata = {
-                .output = wlr_output,
-                .renderer = renderer,
+                .output = output.wlr_output,
+                .render_list = &render_list,
                 .lx = tile.view->x,
                 .ly = tile.view->y,
                 .when = now,
-                .server = &server
+                .server = &server,
+                .view = tile.view,
             };
 
+            // the scrolling plane can be many outputs wide, most tiles aren't on this one
+            if (occluded || !view_intersects_box(*tile.view, *output_box)) {
+                tile.view->for_each_surface(culled_surface_iterator, &rdata);
+                continue;
+            }
+
             tile.view->for_each_surface(render_surface, &rdata);
         }
     }
 
-    if (focused_tiled) {
-        auto& focused_view_r = focused_view.unwrap();
+    if (top_tiled) {
+        auto& top_view_r = top_view.unwrap();
         RenderData rdata = {
-            .output = wlr_output,
-            .renderer = renderer,
-            .lx = focused_view_r.x,
-            .ly = focused_view_r.y,
+            .output = output.wlr_output,
+            .render_list = &render_list,
+            .lx = top_view_r.x,
+            .ly = top_view_r.y,
             .when = now,
-            .server = &server
+            .server = &server,
+            .view = &top_view_r,
         };
 
-        focused_view_r.for_each_surface(render_surface, &rdata);
+        top_view_r.for_each_surface(render_surface, &rdata);
     }
 }
 
-static void render_floating(Server& server, Workspace& ws, OptionalRef<View> ancestor, struct wlr_output* wlr_output, struct wlr_renderer* renderer, struct timespec* now)
+static void render_floating(Server& server, Workspace& ws, OptionalRef<View> ancestor, struct wlr_output* wlr_output, std::vector<RenderItem>& render_list, struct timespec* now)
 {
     auto focused_view = server.seat.get_focused_view();
 
@@ -151,11 +588,12 @@ static void render_floating(Server& server, Workspace& ws, OptionalRef<View> anc
 
         RenderData rdata = {
             .output = wlr_output,
-            .renderer = renderer,
+            .render_list = &render_list,
             .lx = view->x,
             .ly = view->y,
             .when = now,
-            .server = &server
+            .server = &server,
+            .view = view,
         };
 
         view->for_each_surface(render_surface, &rdata);
@@ -165,18 +603,20 @@ static void render_floating(Server& server, Workspace& ws, OptionalRef<View> anc
         auto& focused_view_r = focused_view.unwrap();
         RenderData rdata = {
             .output = wlr_output,
-            .renderer = renderer,
+            .render_list = &render_list,
             .lx = focused_view_r.x,
             .ly = focused_view_r.y,
             .when = now,
-            .server = &server
+            .server = &server,
+            .view = &focused_view_r,
         };
 
         focused_view_r.for_each_surface(render_surface, &rdata);
     }
 }
 
-static void render_layer(Server& server, LayerArray::value_type& surfaces, Output& output, struct wlr_renderer* renderer, struct timespec* now)
+/// If \a culled, the surfaces aren't drawn because something opaque covers them.
+static void render_layer(Server& server, LayerArray::value_type& surfaces, Output& output, std::vector<RenderItem>& render_list, struct timespec* now, bool culled = false)
 {
     const struct wlr_box* output_box = server.output_manager->get_output_box(output);
     for (const auto& surface : surfaces) {
@@ -186,19 +626,19 @@ static void render_layer(Server& server, LayerArray::value_type& surfaces, Outpu
 
         RenderData rdata = {
             .output = output.wlr_output,
-            .renderer = renderer,
+            .render_list = &render_list,
             .lx = surface.geometry.x + output_box->x,
             .ly = surface.geometry.y + output_box->y,
             .when = now,
             .server = &server
         };
 
-        wlr_layer_surface_v1_for_each_surface(surface.surface, render_surface, &rdata);
+        wlr_layer_surface_v1_for_each_surface(surface.surface, culled ? culled_surface_iterator : render_surface, &rdata);
     }
 }
 
 #if HAVE_XWAYLAND
-static void render_xwayland_or_surface(Server& server, struct wlr_output* wlr_output, struct wlr_renderer* renderer, struct timespec* now)
+static void render_xwayland_or_surface(Server& server, struct wlr_output* wlr_output, std::vector<RenderItem>& render_list, struct timespec* now)
 {
     for (const auto& xwayland_or_surface : server.surface_manager.xwayland_or_surfaces) {
         if (!xwayland_or_surface->mapped || !xwayland_or_surface->xwayland_surface->surface) {
@@ -206,7 +646,7 @@ static void render_xwayland_or_surface(Server& server, struct wlr_output* wlr_ou
         }
         RenderData rdata = {
             .output = wlr_output,
-            .renderer = renderer,
+            .render_list = &render_list,
             .lx = xwayland_or_surface->lx,
             .ly = xwayland_or_surface->ly,
             .when = now,
@@ -218,6 +658,136 @@ static void render_xwayland_or_surface(Server& server, struct wlr_output* wlr_ou
 }
 #endif
 
+/// Appends the focus highlight around the column of the focused view of \a ws, if it's tiled.
+static void render_focus_highlight(Server& server, Workspace& ws, Output& output, std::vector<RenderItem>& render_list)
+{
+    auto focused_view_ptr = server.seat.get_focused_view();
+    if (!focused_view_ptr) {
+        return;
+    }
+    auto focused_view = focused_view_ptr.raw_pointer();
+
+    auto column_it = ws.find_column(focused_view);
+    if (column_it == ws.columns.end()) {
+        return;
+    }
+
+    wlr_box column_dimensions = {
+        .x = focused_view->x + focused_view->geometry.x - server.config.gap / 2,
+        .y = focused_view->y + focused_view->geometry.y - server.config.gap / (column_it->tiles.size() == 1 ? 1 : 2),
+        .width = focused_view->target_width + server.config.gap,
+        .height = focused_view->target_height + (column_it->tiles.size() == 1 ? 2 : 1) * server.config.gap
+    };
+
+    auto& item = render_list.emplace_back();
+    item.box = layout_box_to_output(server, output, column_dimensions);
+    item.texture = nullptr;
+    item.surface = nullptr;
+
+    wl_output_transform transform = wlr_output_transform_invert(
+        focused_view->get_surface()->current.transform);
+    wlr_matrix_project_box(item.matrix.data(), &item.box, transform, 0, output.wlr_output->transform_matrix);
+
+    auto focus_color = server.config.focus_color;
+    // premultiply components
+    item.color = { focus_color.r * focus_color.a, focus_color.g * focus_color.a, focus_color.b * focus_color.a, focus_color.a };
+}
+
+static void count_surface_iterator(struct wlr_surface*, int, int, void* data)
+{
+    (*static_cast<size_t*>(data))++;
+}
+
+/**
+ * \brief Returns the view whose buffer can be shown on \a output as it is, instead of compositing the frame.
+ *
+ * That's the fullscreen view of the only workspace of the output, if it's a single surface that covers the output
+ * exactly, with the same scale and transform, and if nothing is drawn over it: no popups, transient floating
+ * views, Xwayland unmanaged surfaces or overlay layer surfaces.
+ */
+static OptionalRef<View> find_scan_out_view(Server& server, Output& output)
+{
+    Workspace* workspace = nullptr;
+    for (auto& ws : server.output_manager->workspaces) {
+        if (ws.output.raw_pointer() == &output) {
+            if (workspace != nullptr) {
+                return NullRef<View>;
+            }
+            workspace = &ws;
+        }
+    }
+    if (workspace == nullptr || !workspace->fullscreen_view) {
+        return NullRef<View>;
+    }
+
+    View& view = workspace->fullscreen_view.unwrap();
+    struct wlr_surface* surface = view.get_surface();
+    if (!view.mapped || surface == nullptr || surface->buffer == nullptr) {
+        return NullRef<View>;
+    }
+
+    size_t surfaces_number = 0;
+    view.for_each_surface(count_surface_iterator, &surfaces_number);
+    if (surfaces_number != 1) {
+        return NullRef<View>;
+    }
+
+    const struct wlr_box* output_box = server.output_manager->get_output_box(output);
+    if (view.x != output_box->x || view.y != output_box->y
+        || surface->current.width != output_box->width || surface->current.height != output_box->height
+        || static_cast<float>(surface->current.scale) != output.wlr_output->scale
+        || surface->current.transform != output.wlr_output->transform) {
+        return NullRef<View>;
+    }
+
+    // tiles are drawn before the focused one, which may not be the fullscreen view
+    if (server.seat.get_focused_view().raw_pointer() != &view) {
+        for (const auto& column : workspace->columns) {
+            for (const auto& tile : column.tiles) {
+                if (tile.view != &view && tile.view->mapped) {
+                    struct wlr_box box = { tile.view->x, tile.view->y, tile.view->geometry.width, tile.view->geometry.height };
+                    struct wlr_box intersection;
+                    if (wlr_box_intersection(&intersection, &box, output_box)) {
+                        return NullRef<View>;
+                    }
+                }
+            }
+        }
+    }
+
+    for (const auto& floating_view : workspace->floating_views) {
+        if (floating_view != &view && floating_view->mapped && floating_view->is_transient_for(view)) {
+            return NullRef<View>;
+        }
+    }
+
+#if HAVE_XWAYLAND
+    for (const auto& xwayland_or_surface : server.surface_manager.xwayland_or_surfaces) {
+        if (!xwayland_or_surface->mapped || !xwayland_or_surface->xwayland_surface->surface) {
+            continue;
+        }
+        struct wlr_box box = {
+            xwayland_or_surface->lx,
+            xwayland_or_surface->ly,
+            xwayland_or_surface->xwayland_surface->surface->current.width,
+            xwayland_or_surface->xwayland_surface->surface->current.height,
+        };
+        struct wlr_box intersection;
+        if (wlr_box_intersection(&intersection, &box, output_box)) {
+            return NullRef<View>;
+        }
+    }
+#endif
+
+    for (const auto& layer_surface : server.surface_manager.layers[ZWLR_LAYER_SHELL_V1_LAYER_OVERLAY]) {
+        if (layer_surface.surface->mapped && layer_surface.is_on_output(output)) {
+            return NullRef<View>;
+        }
+    }
+
+    return view;
+}
+
 /// Not used yet but it's going to be useful one day.
 [[maybe_unused]] static double delta_time(struct timespec& x, struct timespec& y)
 {
@@ -243,44 +813,100 @@ static void render_xwayland_or_surface(Server& server, struct wlr_output* wlr_ou
     return static_cast<double>(delta.tv_sec) + static_cast<double>(delta.tv_nsec) / 1000000000.0;
 }
 
+/// Estimates when the frame that is about to be rendered on \a output will be shown on the screen.
+static ViewAnimation::Clock::time_point predict_presentation_time(const Output& output, const struct timespec& now)
+{
+    using namespace std::chrono;
+    // both the presentation clock and the steady clock are CLOCK_MONOTONIC
+    const auto to_time_point = [](const struct timespec& ts) {
+        return ViewAnimation::Clock::time_point(
+            duration_cast<ViewAnimation::Clock::duration>(seconds(ts.tv_sec) + nanoseconds(ts.tv_nsec)));
+    };
+
+    const auto now_point = to_time_point(now);
+    const auto last_present = to_time_point(output.last_present);
+    // refresh is expressed in mHz, and it's zero when unknown
+    if (output.wlr_output->refresh <= 0 || last_present > now_point || now_point - last_present > seconds(1)) {
+        return now_point;
+    }
+
+    const nanoseconds refresh_period { 1'000'000'000'000LL / output.wlr_output->refresh };
+    // the first vblank after now
+    return last_present + ((now_point - last_present) / refresh_period + 1) * refresh_period;
+}
+
 void Output::frame_handler(struct wl_listener* listener, void*)
 {
     Server* server = get_server(listener);
     auto* output = get_listener_data<Output*>(listener);
     auto* wlr_output = output->wlr_output;
     struct wlr_renderer* renderer = server->renderer;
+    ScopedTimer timer(server->stats, &Stats::frame);
 
     struct timespec now;
     clock_gettime(CLOCK_MONOTONIC, &now);
 
-    server->seat.update_swipe(*server);
+    server->seat.update_swipe(*server, *output);
+    // place the animated views where they should be when this frame reaches the screen
+    server->view_animation->tick(*output, predict_presentation_time(*output, now));
 
-    // make the OpenGL context current
-    if (!wlr_output_attach_render(wlr_output, nullptr)) {
+    // make the OpenGL context current and get the region that needs to be repainted
+    bool needs_frame;
+    pixman_region32_t damage;
+    pixman_region32_init(&damage);
+    if (!wlr_output_damage_attach_render(output->damage, &needs_frame, &damage)) {
+        pixman_region32_fini(&damage);
         return;
     }
 
     int width, height;
-    // the effective resolution takes the rotation of outputs in account
-    wlr_output_effective_resolution(wlr_output, &width, &height);
-    wlr_renderer_begin(renderer, width, height);
+    // show the buffer of a fullscreen client directly, replacing the render buffer that has just been attached.
+    // wlroots refuses it when the output can't, or when a software cursor has to be drawn
+    bool scan_out = false;
+    if (needs_frame) {
+        if (auto scan_out_view = find_scan_out_view(*server, *output);
+            scan_out_view && wlr_output_attach_buffer(wlr_output, scan_out_view.unwrap().get_surface()->buffer)) {
+            scan_out = wlr_output_commit(wlr_output);
+            if (!scan_out && !wlr_output_attach_render(wlr_output, nullptr)) {
+                pixman_region32_fini(&damage);
+                return;
+            }
+        }
 
-    std::array<float, 4> color = { .3, .3, .3, 1. };
-    wlr_renderer_clear(renderer, color.data());
+        if (scan_out != output->scanned_out) {
+            wlr_log(WLR_DEBUG, "%s scan-out on output %s", scan_out ? "Starting" : "Stopping", wlr_output->name);
+        }
+        if (!scan_out && output->scanned_out) {
+            // the render buffers are as old as the scan-out, repaint them entirely
+            wlr_output_damage_add_whole(output->damage);
+            wlr_output_transformed_resolution(wlr_output, &width, &height);
+            pixman_region32_union_rect(&damage, &damage, 0, 0, width, height);
+        }
+        output->scanned_out = scan_out;
+    }
 
     int workspaces_number = 0;
     int fullscreen_workspaces_number = 0;
+    int occluding_workspaces_number = 0;
 
     for (auto& ws : server->output_manager->workspaces) {
         if (ws.output.raw_pointer() == output) {
             workspaces_number++;
             fullscreen_workspaces_number += static_cast<bool>(ws.fullscreen_view);
+            occluding_workspaces_number += fullscreen_view_occludes_output(*server, ws, *output);
         }
     }
+    // opaque fullscreen views cover the whole output, nothing under them needs to be drawn
+    const bool occluded = workspaces_number > 0 && occluding_workspaces_number == workspaces_number;
+
+    // collect everything to draw, in stacking order. The surfaces are walked even when nothing is composited,
+    // so that clients get their frame callbacks
+    auto& render_list = output->render_list;
+    render_list.clear();
 
     if (fullscreen_workspaces_number != workspaces_number - fullscreen_workspaces_number) {
-        render_layer(*server, server->surface_manager.layers[ZWLR_LAYER_SHELL_V1_LAYER_BACKGROUND], *output, renderer, &now);
-        render_layer(*server, server->surface_manager.layers[ZWLR_LAYER_SHELL_V1_LAYER_BOTTOM], *output, renderer, &now);
+        render_layer(*server, server->surface_manager.layers[ZWLR_LAYER_SHELL_V1_LAYER_BACKGROUND], *output, render_list, &now, occluded);
+        render_layer(*server, server->surface_manager.layers[ZWLR_LAYER_SHELL_V1_LAYER_BOTTOM], *output, render_list, &now, occluded);
     }
 
     for (auto& ws : server->output_manager->workspaces) {
@@ -290,60 +916,90 @@ void Output::frame_handler(struct wl_listener* listener, void*)
         }
 
         if (ws.fullscreen_view) {
-            render_workspace(*server, ws, wlr_output, renderer, &now);
+            render_workspace(*server, ws, *output, render_list, &now);
 #if HAVE_XWAYLAND
-            render_xwayland_or_surface(*server, wlr_output, renderer, &now);
+            render_xwayland_or_surface(*server, wlr_output, render_list, &now);
 #endif
-            render_floating(*server, ws, ws.fullscreen_view, wlr_output, renderer, &now);
+            render_floating(*server, ws, ws.fullscreen_view, wlr_output, render_list, &now);
         } else {
-
-            if (auto focused_view_ptr = server->seat.get_focused_view(); focused_view_ptr) {
-                auto focused_view = focused_view_ptr.raw_pointer();
-
-                if (auto column_it = ws.find_column(focused_view); column_it != ws.columns.end()) {
-                    wlr_box column_dimensions = {
-                        .x = focused_view->x + focused_view->geometry.x - server->config.gap / 2,
-                        .y = focused_view->y + focused_view->geometry.y - server->config.gap / (column_it->tiles.size() == 1 ? 1 : 2),
-                        .width = focused_view->target_width + server->config.gap,
-                        .height = focused_view->target_height + (column_it->tiles.size() == 1 ? 2 : 1) * server->config.gap
-                    };
-
-                    std::array<float, 9> matrix;
-                    wl_output_transform transform = wlr_output_transform_invert(
-                        focused_view->get_surface()->current.transform);
-                    wlr_matrix_project_box(matrix.data(), &column_dimensions, transform, 0, wlr_output->transform_matrix);
-
-                    auto focus_color = server->config.focus_color;
-                    // premultiply components
-                    focus_color.r *= focus_color.a;
-                    focus_color.g *= focus_color.a;
-                    focus_color.b *= focus_color.a;
-                    wlr_render_quad_with_matrix(
-                        renderer,
-                        reinterpret_cast<float*>(&focus_color),
-                        matrix.data());
-                }
-            }
-
-            render_workspace(*server, ws, wlr_output, renderer, &now);
-            wlr_renderer_scissor(renderer, nullptr);
+            render_focus_highlight(*server, ws, *output, render_list);
+            render_workspace(*server, ws, *output, render_list, &now);
 
 #if HAVE_XWAYLAND
-            render_xwayland_or_surface(*server, wlr_output, renderer, &now);
+            render_xwayland_or_surface(*server, wlr_output, render_list, &now);
 #endif
 
-            render_floating(*server, ws, NullRef<View>, wlr_output, renderer, &now);
-            render_layer(*server, server->surface_manager.layers[ZWLR_LAYER_SHELL_V1_LAYER_TOP], *output, renderer, &now);
+            render_floating(*server, ws, NullRef<View>, wlr_output, render_list, &now);
+            render_layer(*server, server->surface_manager.layers[ZWLR_LAYER_SHELL_V1_LAYER_TOP], *output, render_list, &now);
         }
     }
 
-    render_layer(*server, server->surface_manager.layers[ZWLR_LAYER_SHELL_V1_LAYER_OVERLAY], *output, renderer, &now);
+    render_layer(*server, server->surface_manager.layers[ZWLR_LAYER_SHELL_V1_LAYER_OVERLAY], *output, render_list, &now);
+
+    if (scan_out) {
+        // the frame has already been committed
+        pixman_region32_fini(&damage);
+        return;
+    }
+
+    if (!needs_frame) {
+        // don't submit a frame if nothing changed on the output
+        wlr_output_rollback(wlr_output);
+        pixman_region32_fini(&damage);
+        return;
+    }
+
+    // the effective resolution takes the rotation of outputs in account
+    wlr_output_effective_resolution(wlr_output, &width, &height);
+    wlr_renderer_begin(renderer, width, height);
+
+    const std::array<float, 4> clear_color = { .3, .3, .3, 1. };
+    struct wlr_texture* software_frame = nullptr;
+    size_t composited = 0;
+    if (server->software_renderer) {
+        software_frame = server->software_renderer->composite(renderer, *output, render_list, occluded ? nullptr : &clear_color, composited);
+    }
+
+    if (software_frame != nullptr) {
+        // the frame covers the output and its texture has no alpha channel, so drawing it
+        // with the blending of the renderer amounts to copying the damaged part
+        wlr_output_transformed_resolution(wlr_output, &width, &height);
+        struct wlr_box box = { .x = 0, .y = 0, .width = width, .height = height };
+        std::array<float, 9> matrix;
+        wlr_matrix_project_box(matrix.data(), &box, WL_OUTPUT_TRANSFORM_NORMAL, 0, wlr_output->transform_matrix);
+        render_damaged(wlr_output, renderer, &damage, box, [renderer, software_frame, &matrix]() {
+            wlr_render_texture_with_matrix(renderer, software_frame, matrix.data(), 1);
+        });
+        submit_render_list(wlr_output, renderer, &damage, std::span { render_list }.subspan(composited));
+    } else {
+        if (!occluded) {
+            int rects_number;
+            pixman_box32_t* rects = pixman_region32_rectangles(&damage, &rects_number);
+            for (int i = 0; i < rects_number; i++) {
+                scissor_output(wlr_output, renderer, rects[i]);
+                wlr_renderer_clear(renderer, clear_color.data());
+            }
+        }
+
+        submit_render_list(wlr_output, renderer, &damage, render_list);
+    }
 
+    wlr_renderer_scissor(renderer, nullptr);
     // in case of software rendered cursor, render it
-    wlr_output_render_software_cursors(wlr_output, nullptr);
+    wlr_output_render_software_cursors(wlr_output, &damage);
 
     // swap buffers and show frame
     wlr_renderer_end(renderer);
+
+    // tell the backend which part of the buffer has changed since the last frame
+    pixman_region32_t frame_damage;
+    pixman_region32_init(&frame_damage);
+    wlr_output_transformed_resolution(wlr_output, &width, &height);
+    wlr_region_transform(&frame_damage, &output->damage->current, wlr_output_transform_invert(wlr_output->transform), width, height);
+    wlr_output_set_damage(wlr_output, &frame_damage);
+    pixman_region32_fini(&frame_damage);
+    pixman_region32_fini(&damage);
+
     wlr_output_commit(wlr_output);
 }
 
@@ -367,6 +1023,16 @@ void Output::destroy_handler(struct wl_listener* listener, void*)
         }
     }
 
+    broadcast_event(*server,
+                    {
+                        .type = libcardboard::ipc::EventType::OutputRemoved,
+                        .output = output->wlr_output->name,
+                    });
+
+    if (server->software_renderer) {
+        server->software_renderer->destroy_output(*output);
+    }
+
     server->listeners.clear_listeners(output);
     server->output_manager->remove_output_from_list(*output);
 }
@@ -3,10 +3,12 @@
 
 extern "C" {
 #include <wayland-server.h>
+#include <wlr/types/wlr_output_damage.h>
 #include <wlr/types/wlr_output_layout.h>
 }
 
 #include <array>
+#include <vector>
 
 #include "Layers.h"
 #include "Server.h"
@@ -18,14 +20,45 @@ extern "C" {
  * Outputs are displays.
  */
 
+class View;
+
+/**
+ * \brief Something to draw in a frame of an output: a surface texture, or a quad of solid color.
+ *
+ * Output::frame_handler first collects them in the order they are stacked, then draws them in one pass.
+ */
+struct RenderItem {
+    /// Where the item is drawn, in output buffer coordinates, before applying the output transform.
+    struct wlr_box box;
+    std::array<float, 9> matrix;
+    /// Drawn if not null, otherwise a quad of \a color is.
+    struct wlr_texture* texture;
+    /// The surface \a texture belongs to.
+    struct wlr_surface* surface;
+    /// Premultiplied color of the quad.
+    std::array<float, 4> color;
+};
+
 struct Output {
     struct wlr_output* wlr_output;
+    /// Accumulates the regions of the output that need to be repainted.
+    struct wlr_output_damage* damage;
     struct wlr_box usable_area;
 
-    /// Time of last presentation. Use it to calculate the delta time.
+    /// Time of last presentation. Used to predict when the next frame will be shown.
     struct timespec last_present;
 
-    /// Executed for each frame render per output.
+    /**
+     * \brief True if the last frame showed the buffer of a fullscreen client directly, without compositing.
+     *
+     * The render buffers haven't been painted meanwhile, so the first composited frame after it repaints everything.
+     */
+    bool scanned_out = false;
+
+    /// The items of the frame being rendered. Kept between frames to reuse its storage.
+    std::vector<RenderItem> render_list;
+
+    /// Executed for each frame render per output, when the output has damage.
     static void frame_handler(struct wl_listener* listener, void* data);
     /// Executed as soon as the first pixel is put on the screen;
     static void present_handler(struct wl_listener* listener, void* data);
@@ -42,4 +75,32 @@ struct Output {
 /// Registers event listeners and does bookkeeping for a newly added output.
 void register_output(Server& server, Output&& output);
 
+/**
+ * \brief Requests a frame event for \a output without damaging it.
+ *
+ * Outputs only produce frames when they have damage or when a frame is requested, so anything that
+ * needs to run on the next frame (grabs, animations) without changing the screen yet must call this.
+ */
+void output_schedule_frame(Output& output);
+
+/// Damages the whole \a output, repainting it entirely on the next frame.
+void output_damage_whole(Output& output);
+
+/// Damages \a box, given in output layout coordinates, on \a output.
+void output_damage_box(Server& server, Output& output, struct wlr_box box);
+
+/**
+ * \brief Damages the surfaces of \a view on the output it is shown on.
+ *
+ * If \a whole is true, the entire area of the view (including the focus border) is damaged,
+ * otherwise only the damage of the surfaces' last commit.
+ */
+void output_damage_view(Server& server, View& view, bool whole);
+
+/// Damages the regions changed by the last commit of \a surface, wherever it is shown.
+void damage_surface(Server& server, struct wlr_surface* surface);
+
+/// Damages every output entirely.
+void damage_all_outputs(Server& server);
+
 #endif // CARDBOARD_OUTPUT_H_INCLUDED
@@ -8,6 +8,7 @@ extern "C" {
 #include "Listener.h"
 #include "Output.h"
 #include "OutputManager.h"
+#include "Server.h"
 
 void OutputManager::register_handlers(Server& server, struct wl_signal* new_output)
 {
@@ -99,6 +100,13 @@ void OutputManager::output_layout_add_handler(struct wl_listener* listener, void
     ws_to_assign->activate(output);
     arrange_layers(*server, output);
 
+    broadcast_event(*server,
+                    {
+                        .type = libcardboard::ipc::EventType::OutputAdded,
+                        .workspace = static_cast<int32_t>(ws_to_assign->index),
+                        .output = output.wlr_output->name,
+                    });
+
     // the output doesn't need to be exposed as a wayland global
     // because wlr_output_layout does it for us already
 }
@@ -167,12 +167,15 @@ void Seat::focus_view(Server& server, OptionalRef<View> view, bool condense_work
         // deactivate previous surface
         prev_view.unwrap().close_popups();
         prev_view.unwrap().set_activated(false);
+        // repaint without the focus border
+        output_damage_view(server, prev_view.unwrap(), true);
         wlr_seat_keyboard_clear_focus(wlr_seat);
     }
 
     // if the view is null, then focus_view will only
     // unfocus the previously focused one
     if (!view) {
+        broadcast_event(server, { .type = libcardboard::ipc::EventType::ViewFocused });
         return;
     }
 
@@ -193,8 +196,16 @@ void Seat::focus_view(Server& server, OptionalRef<View> view, bool condense_work
         server.surface_manager.move_view_to_front(view_r);
         // activate surface
         view_r.set_activated(true);
+        output_damage_view(server, view_r, true);
         // the seat will send keyboard events to the view automatically
         keyboard_notify_enter(view_r.get_surface());
+
+        broadcast_event(server,
+                        {
+                            .type = libcardboard::ipc::EventType::ViewFocused,
+                            .workspace = static_cast<int32_t>(view_r.workspace_id),
+                            .view = view_r.id,
+                        });
     }
 
 fit_on_screen:
@@ -439,6 +450,9 @@ void Seat::process_swipe_update(Server& server, uint32_t fingers, double dx, dou
 
         data->delta_since_update += dx * WORKSPACE_SCROLL_SENSITIVITY;
         data->ready = true;
+        data->workspace->output.and_then([](auto& output) {
+            output_schedule_frame(output);
+        });
     }
 }
 
@@ -470,6 +484,9 @@ void Seat::process_swipe_end(Server& server)
         GrabState::WorkspaceScroll* data = std::get_if<GrabState::WorkspaceScroll>(&grab_state->grab_data);
         data) {
         data->wants_to_stop = true;
+        data->workspace->output.and_then([](auto& output) {
+            output_schedule_frame(output);
+        });
         wlr_log(WLR_DEBUG, "fingers were lifted - swipe stopping");
     }
 }
@@ -497,14 +514,14 @@ void Seat::end_touchpad_swipe(Server& server)
     }
 }
 
-void Seat::update_swipe(Server& server)
+void Seat::update_swipe(Server& server, Output& output)
 {
     GrabState::WorkspaceScroll* data;
     if (!grab_state.has_value() || !(data = std::get_if<GrabState::WorkspaceScroll>(&grab_state->grab_data))) {
         return;
     }
 
-    if (!data->ready) {
+    if (!data->ready || data->workspace->output.raw_pointer() != &output) {
         return;
     }
 
@@ -514,15 +531,18 @@ void Seat::update_swipe(Server& server)
     }
 
     data->scroll_x -= data->speed;
-    scroll_workspace(*(server.output_manager), *data->workspace, AbsoluteScroll { static_cast<int>(data->scroll_x) }, false);
-    data->workspace->find_dominant_view(*(server.output_manager), *this, get_focused_view()).and_then([data](auto& dominant) {
-        data->dominant_view = OptionalRef(dominant);
-    });
-    if (data->dominant_view) {
-        get_focused_view().and_then([](auto& view) {
-            view.set_activated(false);
+    // don't re-arrange (and repaint) the workspace for sub-pixel movements
+    if (static_cast<int>(data->scroll_x) != data->workspace->scroll_x) {
+        scroll_workspace(*(server.output_manager), *data->workspace, AbsoluteScroll { static_cast<int>(data->scroll_x) }, false);
+        data->workspace->find_dominant_view(*(server.output_manager), *this, get_focused_view()).and_then([data](auto& dominant) {
+            data->dominant_view = OptionalRef(dominant);
         });
-        data->dominant_view.unwrap().set_activated(true);
+        if (data->dominant_view) {
+            get_focused_view().and_then([](auto& view) {
+                view.set_activated(false);
+            });
+            data->dominant_view.unwrap().set_activated(true);
+        }
     }
 
     data->speed *= WORKSPACE_SCROLL_FRICTION;
@@ -530,6 +550,12 @@ void Seat::update_swipe(Server& server)
     if (data->wants_to_stop && fabs(data->speed) < 1) {
         focus_view(server, OptionalRef(data->dominant_view));
         end_touchpad_swipe(server);
+        return;
+    }
+
+    // keep the momentum going; a resting swipe is woken up again by process_swipe_update
+    if (data->wants_to_stop || fabs(data->speed) >= WORKSPACE_SCROLL_MIN_SPEED) {
+        output_schedule_frame(output);
     }
 }
 
@@ -628,6 +654,17 @@ void Seat::focus(Server& server, Workspace& workspace)
         return;
     }
 
+    {
+        // a workspace that isn't shown yet replaces the focused one on its output
+        auto output = workspace.output ? workspace.output : get_focused_workspace(server).and_then<Output>([](auto& ws) { return ws.output; });
+        broadcast_event(server,
+                        {
+                            .type = libcardboard::ipc::EventType::WorkspaceFocused,
+                            .workspace = static_cast<int32_t>(workspace.index),
+                            .output = output ? output.unwrap().wlr_output->name : "",
+                        });
+    }
+
     if (!workspace.output.has_value()) {
         bool do_return = true;
         Workspace& previous_workspace = get_focused_workspace(server).unwrap();
@@ -849,7 +886,7 @@ void Seat::cursor_button_handler(struct wl_listener* listener, void* data)
 
     double sx, sy;
     struct wlr_surface* surface;
-    auto view = server->surface_manager.get_surface_under_cursor(*(server->output_manager), seat->cursor.wlr_cursor->x, seat->cursor.wlr_cursor->y, surface, sx, sy);
+    auto view = server->surface_manager.get_surface_under_cursor(*(server->output_manager), *(server->view_animation), seat->cursor.wlr_cursor->x, seat->cursor.wlr_cursor->y, surface, sx, sy);
     if (!view) {
         wlr_seat_pointer_notify_button(seat->wlr_seat, event->time_msec, event->button, event->state);
         return;
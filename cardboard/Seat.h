@@ -23,11 +23,13 @@ extern "C" {
 
 struct Server;
 struct OutputManager;
+struct Output;
 
 constexpr const char* DEFAULT_SEAT = "seat0";
 const int WORKSPACE_SCROLL_FINGERS = 3;
 const double WORKSPACE_SCROLL_SENSITIVITY = 2.0; ///< sensitivity multiplier
 const double WORKSPACE_SCROLL_FRICTION = 0.9; ///< friction multiplier
+const double WORKSPACE_SCROLL_MIN_SPEED = 0.1; ///< below this speed the workspace is considered at rest
 const int WORKSPACE_SWITCH_FINGERS = 4;
 
 struct Seat {
@@ -112,8 +114,13 @@ struct Seat {
     void end_interactive(Server& server);
     void end_touchpad_swipe(Server& server);
 
-    /// Updates the scroll of the workspace during three-finger swipe, taking in account speed and friction.
-    void update_swipe(Server& server);
+    /**
+     * \brief Updates the scroll of the workspace during three-finger swipe, taking in account speed and friction.
+     *
+     * Called on each frame of \a output. Only the output of the scrolled workspace advances the swipe, and
+     * it keeps requesting frames for as long as the workspace is moving.
+     */
+    void update_swipe(Server& server, Output& output);
 
     /// Returns true if the \a view is currently in a grab operation.
     bool is_grabbing(View& view);
@@ -22,9 +22,13 @@ extern "C" {
 #include <cardboard/ipc.h>
 #include <wlr_cpp_fixes/types/wlr_layer_shell_v1.h>
 
+#include <signal.h>
 #include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
 
 #include <cassert>
+#include <cerrno>
 
 #include "Helpers.h"
 #include "IPC.h"
@@ -35,18 +39,31 @@ extern "C" {
 bool Server::init()
 {
     wl_display = wl_display_create();
+    event_loop = wl_display_get_event_loop(wl_display);
+
+    // blocks SIGCHLD, before the backend starts threads that would receive it instead
+    sigchld_event_source = wl_event_loop_add_signal(event_loop, SIGCHLD, Server::sigchld_handler, this);
+
     // let wlroots select the required hardware abstractions
     backend = wlr_backend_autocreate(wl_display, nullptr);
 
-    event_loop = wl_display_get_event_loop(wl_display);
-
     renderer = wlr_backend_get_renderer(backend);
     wlr_renderer_init_wl_display(renderer, wl_display);
 
+    if (const char* software_rendering = getenv(SOFTWARE_RENDERING_ENV.data());
+        software_rendering != nullptr && std::string_view(software_rendering) == "1") {
+        wlr_log(WLR_INFO, "Compositing on the CPU");
+        software_renderer = std::make_unique<SoftwareRenderer>();
+    }
+
     compositor = wlr_compositor_create(wl_display, renderer);
     wlr_data_device_manager_create(wl_display); // for clipboard managers
 
     output_manager = create_output_manager(this);
+    view_animation = create_view_animation(this, { 17, 100 });
+
+    // armed by the commits that wait for a frame callback
+    hidden_frame_done_timer = wl_event_loop_add_timer(event_loop, Server::hidden_frame_done_handler, this);
 
     // https://drewdevault.com/2018/07/29/Wayland-shells.html
     // TODO: implement Xwayland
@@ -73,6 +90,7 @@ bool Server::init()
     }
 
     register_handlers(*this, NoneT {}, {
+                                           { &compositor->events.new_surface, Server::new_surface_handler },
                                            { &xdg_shell->events.new_surface, Server::new_xdg_surface_handler },
                                            { &layer_shell->events.new_surface, Server::new_layer_surface_handler },
                                        });
@@ -97,8 +115,9 @@ bool Server::init_ipc()
         socket_path = "/tmp/cardboard-" + display;
     }
 
-    ipc = create_ipc(*this, socket_path, [this](const CommandData& command_data) -> std::string {
-              return dispatch_command(command_data)(this).message;
+    ipc = create_ipc(*this, socket_path, [this](const CommandData& command_data, std::string& response) {
+              // appended rather than moved, to keep the capacity of the buffer
+              response.append(dispatch_command(command_data)(this).message);
           }).value();
 
     return true;
@@ -142,17 +161,12 @@ bool Server::load_settings()
 
     wlr_log(WLR_DEBUG, "Running config file %s", config_path.c_str());
 
-    auto error_code = spawn([&]() {
-        execle(config_path.c_str(), config_path.c_str(), nullptr, environ);
-
-        return EXIT_FAILURE;
-    });
-    if (error_code.value() != 0) {
-        wlr_log(WLR_ERROR, "Couldn't execute the config file: %s", error_code.message().c_str());
-        return false;
-    }
-
-    return true;
+    // the config script may still fail after it started, which sigchld_handler logs
+    return spawn(*this, { config_path })
+        .map_error([](const std::error_code& error_code) {
+            wlr_log(WLR_ERROR, "Couldn't execute the config file: %s", error_code.message().c_str());
+        })
+        .has_value();
 }
 
 bool Server::run()
@@ -179,8 +193,6 @@ bool Server::run()
         return false;
     }
 
-    view_animation = create_view_animation(this, { 17, 100 });
-
     wlr_log(WLR_INFO, "Running Cardboard on WAYLAND_DISPLAY=%s", socket);
     wl_display_run(wl_display);
 
@@ -190,6 +202,7 @@ bool Server::run()
 void Server::stop()
 {
     ipc = nullptr; // release ipc system
+    software_renderer = nullptr; // its textures need the renderer
     wlr_log(WLR_INFO, "Shutting down Cardboard");
 #if HAVE_XWAYLAND
     wlr_xwayland_destroy(xwayland);
@@ -204,6 +217,115 @@ void Server::teardown(int code)
     exit_code = code;
 }
 
+int Server::sigchld_handler(int, void* data)
+{
+    auto* server = static_cast<Server*>(data);
+
+    // signals coalesce, several children may have exited.
+    // Only our own children are waited for, the ones of wlroots, like Xwayland, are reaped by it
+    for (auto it = server->children.begin(); it != server->children.end();) {
+        int status;
+        pid_t pid = it->first;
+        if (pid_t result = waitpid(pid, &status, WNOHANG); result == 0 || (result == -1 && errno != ECHILD)) {
+            ++it;
+            continue;
+        } else if (result == -1) {
+            // somebody else reaped it
+            it = server->children.erase(it);
+            continue;
+        }
+
+        if (WIFEXITED(status) && WEXITSTATUS(status) != EXIT_SUCCESS) {
+            wlr_log(WLR_ERROR, "%s (pid %d) exited with status %d", it->second.c_str(), pid, WEXITSTATUS(status));
+        } else if (WIFSIGNALED(status)) {
+            wlr_log(WLR_ERROR, "%s (pid %d) was killed by signal %d", it->second.c_str(), pid, WTERMSIG(status));
+        } else {
+            wlr_log(WLR_DEBUG, "%s (pid %d) exited", it->second.c_str(), pid);
+        }
+        it = server->children.erase(it);
+    }
+
+    return 0;
+}
+
+int Server::hidden_frame_done_handler(void* data)
+{
+    auto* server = static_cast<Server*>(data);
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    server->hidden_frame_done_armed = false;
+    for (auto& [surface, shown] : server->surfaces_shown) {
+        if (wl_list_empty(&surface->current.frame_callback_list)) {
+            shown = false;
+            continue;
+        }
+
+        if (!shown) {
+            wlr_surface_send_frame_done(surface, &now);
+            if (server->stats) {
+                server->stats->throttled_frame_done++;
+            }
+        } else {
+            // drawn since the last run, but it committed again. Check it on the next run,
+            // in case it got hidden before it was drawn
+            server->arm_hidden_frame_done();
+        }
+        shown = false;
+    }
+
+    return 0;
+}
+
+void Server::arm_hidden_frame_done()
+{
+    if (!hidden_frame_done_armed) {
+        wl_event_source_timer_update(hidden_frame_done_timer, HIDDEN_FRAME_DONE_INTERVAL);
+        hidden_frame_done_armed = true;
+    }
+}
+
+void Server::new_surface_handler(struct wl_listener* listener, void* data)
+{
+    Server* server = get_server(listener);
+    auto* surface = static_cast<struct wlr_surface*>(data);
+
+    register_handlers(*server, surface, {
+                                            { &surface->events.commit, Server::surface_commit_handler },
+                                            { &surface->events.destroy, Server::surface_destroy_handler },
+                                        });
+    server->surfaces_shown.emplace(surface, false);
+}
+
+void Server::surface_commit_handler(struct wl_listener* listener, void* data)
+{
+    Server* server = get_server(listener);
+    auto* surface = static_cast<struct wlr_surface*>(data);
+
+    if (server->software_renderer) {
+        server->software_renderer->commit_surface(surface, server->output_manager->outputs);
+    }
+    damage_surface(*server, surface);
+
+    // whether the surface will be drawn isn't known yet, if it isn't the timer answers it
+    if (!wl_list_empty(&surface->current.frame_callback_list)) {
+        server->arm_hidden_frame_done();
+    }
+}
+
+void Server::surface_destroy_handler(struct wl_listener* listener, void* data)
+{
+    Server* server = get_server(listener);
+    auto* surface = static_cast<struct wlr_surface*>(data);
+
+    server->listeners.clear_listeners(surface);
+    server->surfaces_shown.erase(surface);
+    if (server->software_renderer) {
+        server->software_renderer->destroy_surface(surface);
+    }
+}
+
 void Server::new_xdg_surface_handler(struct wl_listener* listener, void* data)
 {
     Server* server = get_server(listener);
@@ -39,6 +39,8 @@ extern "C" {
 #include "Output.h"
 #include "OutputManager.h"
 #include "Seat.h"
+#include "SoftwareRenderer.h"
+#include "Stats.h"
 #include "SurfaceManager.h"
 #include "View.h"
 #include "ViewAnimation.h"
@@ -54,6 +56,8 @@ const std::string_view CONFIG_NAME = "cardboardrc"; ///< The name of the config
 const std::string_view CONFIG_HOME_ENV = "XDG_CONFIG_HOME";
 
 const int WORKSPACE_NR = 4; ///< Default number of pre-initialized workspaces.
+/// Milliseconds between the frame callbacks of the surfaces that aren't visible on any output.
+const int HIDDEN_FRAME_DONE_INTERVAL = 1000;
 
 /**
  * \brief Holds all the information of the currently running compositor.
@@ -65,6 +69,8 @@ struct Server {
     struct wlr_compositor* compositor;
     struct wlr_backend* backend;
     struct wlr_renderer* renderer;
+    /// Composites the frames on the CPU instead of with \a renderer, if set. See SOFTWARE_RENDERING_ENV.
+    SoftwareRendererInstance software_renderer;
 
     IPCInstance ipc;
     /// Event loop object for integrating IPC events with the rest of Wayland's event system.
@@ -74,6 +80,24 @@ struct Server {
 
     std::string config_path;
 
+    /// Programs started with spawn() that haven't exited yet, with the program they run.
+    std::unordered_map<pid_t, std::string> children;
+    /// Event source that reaps the children when SIGCHLD arrives, through a signalfd.
+    wl_event_source* sigchld_event_source;
+
+    /**
+     * \brief Every surface of the clients, and whether it has been drawn on an output since the last
+     * run of Server::hidden_frame_done_handler.
+     *
+     * Drawn surfaces get their frame callbacks once per frame of the output, the other ones
+     * only every HIDDEN_FRAME_DONE_INTERVAL.
+     */
+    std::unordered_map<struct wlr_surface*, bool> surfaces_shown;
+    /// Timer that sends the frame callbacks of the surfaces that aren't shown.
+    wl_event_source* hidden_frame_done_timer;
+    /// The timer runs once, HIDDEN_FRAME_DONE_INTERVAL after the first commit that waits for a frame callback.
+    bool hidden_frame_done_armed = false;
+
     struct wlr_xdg_shell* xdg_shell;
     struct wlr_layer_shell_v1* layer_shell;
     struct wlr_xwayland* xwayland;
@@ -88,6 +112,9 @@ struct Server {
 
     Seat seat;
 
+    /// Set by benchmarks to record the duration of the hot paths.
+    Stats* stats = nullptr;
+
     int exit_code = EXIT_SUCCESS;
 
     Server() = default;
@@ -111,6 +138,39 @@ struct Server {
     void teardown(int code);
 
 private:
+    /**
+    * \brief Called on the event loop when children exit.
+    *
+    * Reaps the ones started with spawn(), and logs those that failed. Other children, like Xwayland,
+    * are left to whoever started them.
+    */
+    static int sigchld_handler(int signal_number, void* data);
+
+    /**
+    * \brief Called HIDDEN_FRAME_DONE_INTERVAL after a surface committed with frame callbacks.
+    *
+    * Sends the frame callbacks of the surfaces that haven't been drawn since the previous call,
+    * so that hidden clients keep going, slowly, instead of rendering at the refresh rate.
+    * The timer isn't armed again unless a surface is still waiting, so an idle compositor doesn't wake up.
+    */
+    static int hidden_frame_done_handler(void* data);
+
+    /// Runs hidden_frame_done_handler in HIDDEN_FRAME_DONE_INTERVAL, unless it's already scheduled.
+    void arm_hidden_frame_done();
+
+    /**
+    * \brief Called when a new \c wl_surface is created by a client.
+    *
+    * Listens to the commits of every surface, regardless of its role, to damage the outputs it's shown on.
+    */
+    static void new_surface_handler(struct wl_listener* listener, void* data);
+
+    /// Called when a \c wl_surface commits a new state.
+    static void surface_commit_handler(struct wl_listener* listener, void* data);
+
+    /// Called when a \c wl_surface is destroyed.
+    static void surface_destroy_handler(struct wl_listener* listener, void* data);
+
     /**
     * \brief Called when a new \c xdg_surface is created by a client.
     *
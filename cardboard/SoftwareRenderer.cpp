@@ -0,0 +1,298 @@
+extern "C" {
+#include <wayland-server.h>
+#define static
+#include <wlr/render/wlr_renderer.h>
+#include <wlr/render/wlr_texture.h>
+#undef static
+#include <wlr/types/wlr_buffer.h>
+#include <wlr/types/wlr_output.h>
+#include <wlr/types/wlr_output_damage.h>
+#include <wlr/types/wlr_surface.h>
+}
+
+#include <optional>
+#include <span>
+
+#include "Output.h"
+#include "SoftwareRenderer.h"
+
+/// The pixman format with the same memory layout as \a format, if any.
+static std::optional<pixman_format_code_t> shm_format_to_pixman(uint32_t format)
+{
+    switch (format) {
+    case WL_SHM_FORMAT_ARGB8888:
+        return PIXMAN_a8r8g8b8;
+    case WL_SHM_FORMAT_XRGB8888:
+        return PIXMAN_x8r8g8b8;
+    case WL_SHM_FORMAT_ABGR8888:
+        return PIXMAN_a8b8g8r8;
+    case WL_SHM_FORMAT_XBGR8888:
+        return PIXMAN_x8b8g8r8;
+    default:
+        return std::nullopt;
+    }
+}
+
+static pixman_color_t to_pixman_color(const std::array<float, 4>& color)
+{
+    return {
+        .red = static_cast<uint16_t>(color[0] * 0xffff),
+        .green = static_cast<uint16_t>(color[1] * 0xffff),
+        .blue = static_cast<uint16_t>(color[2] * 0xffff),
+        .alpha = static_cast<uint16_t>(color[3] * 0xffff),
+    };
+}
+
+/// Returns true if \a surface was drawn in the last frame of one of \a outputs.
+static bool is_surface_shown(struct wlr_surface* surface, const std::list<Output>& outputs)
+{
+    for (const auto& output : outputs) {
+        for (const auto& item : output.render_list) {
+            if (item.surface == surface) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+SoftwareRenderer::~SoftwareRenderer()
+{
+    for (auto& [surface, image] : surfaces) {
+        if (image != nullptr) {
+            pixman_image_unref(image);
+        }
+    }
+    for (auto& [output, shadow] : outputs) {
+        destroy_shadow_buffer(shadow);
+    }
+}
+
+void SoftwareRenderer::commit_surface(struct wlr_surface* surface, const std::list<Output>& outputs)
+{
+    auto it = surfaces.find(surface);
+
+    if (surface->buffer == nullptr) {
+        destroy_surface(surface);
+        return;
+    }
+
+    // new surfaces are copied right away, they are likely to be shown next.
+    // The others only while they're shown, a stale copy is dropped and the next commit copies the whole buffer
+    if (it != surfaces.end() && !is_surface_shown(surface, outputs)) {
+        if (it->second != nullptr) {
+            pixman_image_unref(it->second);
+            it->second = nullptr;
+        }
+        return;
+    }
+
+    if (it != surfaces.end() && it->second != nullptr && !pixman_region32_not_empty(&surface->buffer_damage)) {
+        return;
+    }
+
+    // the client may have destroyed the buffer after it was released
+    struct wl_shm_buffer* shm_buffer = surface->buffer->resource ? wl_shm_buffer_get(surface->buffer->resource) : nullptr;
+    auto format = shm_buffer ? shm_format_to_pixman(wl_shm_buffer_get_format(shm_buffer)) : std::nullopt;
+    if (!format) {
+        destroy_surface(surface);
+        return;
+    }
+
+    int width = wl_shm_buffer_get_width(shm_buffer);
+    int height = wl_shm_buffer_get_height(shm_buffer);
+
+    pixman_image_t* copy = it != surfaces.end() ? it->second : nullptr;
+    bool whole = copy == nullptr || pixman_image_get_format(copy) != *format
+                 || pixman_image_get_width(copy) != width || pixman_image_get_height(copy) != height;
+    if (whole) {
+        if (copy != nullptr) {
+            pixman_image_unref(copy);
+        }
+        copy = pixman_image_create_bits(*format, width, height, nullptr, 0);
+        if (copy == nullptr) {
+            surfaces.erase(surface);
+            return;
+        }
+        surfaces[surface] = copy;
+    }
+
+    wl_shm_buffer_begin_access(shm_buffer);
+    pixman_image_t* source = pixman_image_create_bits(*format,
+                                                      width,
+                                                      height,
+                                                      static_cast<uint32_t*>(wl_shm_buffer_get_data(shm_buffer)),
+                                                      wl_shm_buffer_get_stride(shm_buffer));
+    pixman_image_set_clip_region32(copy, whole ? nullptr : &surface->buffer_damage);
+    pixman_image_composite32(PIXMAN_OP_SRC, source, nullptr, copy, 0, 0, 0, 0, 0, 0, width, height);
+    pixman_image_set_clip_region32(copy, nullptr);
+    pixman_image_unref(source);
+    wl_shm_buffer_end_access(shm_buffer);
+}
+
+void SoftwareRenderer::destroy_surface(struct wlr_surface* surface)
+{
+    if (auto it = surfaces.find(surface); it != surfaces.end()) {
+        if (it->second != nullptr) {
+            pixman_image_unref(it->second);
+        }
+        surfaces.erase(it);
+    }
+}
+
+void SoftwareRenderer::destroy_output(Output& output)
+{
+    if (auto it = outputs.find(&output); it != outputs.end()) {
+        destroy_shadow_buffer(it->second);
+        outputs.erase(it);
+    }
+}
+
+void SoftwareRenderer::destroy_shadow_buffer(ShadowBuffer& shadow)
+{
+    if (shadow.texture != nullptr) {
+        wlr_texture_destroy(shadow.texture);
+    }
+    if (shadow.image != nullptr) {
+        pixman_image_unref(shadow.image);
+    }
+    shadow = {};
+}
+
+struct wlr_texture* SoftwareRenderer::composite(struct wlr_renderer* renderer, Output& output, const std::vector<RenderItem>& render_list, const std::array<float, 4>* clear_color, size_t& composited)
+{
+    auto& shadow = outputs[&output];
+
+    // surfaces that weren't copied because they were hidden until now are drawn by the renderer until they commit again,
+    // together with everything over them
+    composited = 0;
+    for (; composited < render_list.size(); composited++) {
+        const auto& item = render_list[composited];
+        if (item.texture == nullptr) {
+            continue;
+        }
+        if (auto it = surfaces.find(item.surface); it == surfaces.end() || it->second == nullptr
+            || item.surface->current.transform != WL_OUTPUT_TRANSFORM_NORMAL) {
+            break;
+        }
+    }
+
+    // the shadow buffer only holds the items below the first one left to the renderer, it's stale if that one changed
+    struct wlr_surface* first_left = composited < render_list.size() ? render_list[composited].surface : nullptr;
+    if (composited != shadow.composited || first_left != shadow.first_left) {
+        shadow.valid = false;
+        shadow.composited = composited;
+        shadow.first_left = first_left;
+    }
+
+    if (composited == 0) {
+        shadow.valid = false;
+        return nullptr;
+    }
+
+    // the shadow buffer is in the same coordinates as the boxes of the items
+    int width, height;
+    wlr_output_transformed_resolution(output.wlr_output, &width, &height);
+    if (shadow.image == nullptr || pixman_image_get_width(shadow.image) != width || pixman_image_get_height(shadow.image) != height) {
+        destroy_shadow_buffer(shadow);
+        shadow.image = pixman_image_create_bits(PIXMAN_x8r8g8b8, width, height, nullptr, 0);
+        if (shadow.image == nullptr) {
+            return nullptr;
+        }
+        shadow.texture = wlr_texture_from_pixels(renderer,
+                                                 WL_SHM_FORMAT_XRGB8888,
+                                                 pixman_image_get_stride(shadow.image),
+                                                 width,
+                                                 height,
+                                                 pixman_image_get_data(shadow.image));
+        if (shadow.texture == nullptr) {
+            destroy_shadow_buffer(shadow);
+            return nullptr;
+        }
+    }
+
+    // unlike the buffers of the output, the shadow buffer holds the previous frame,
+    // only what changed since then is composited
+    pixman_region32_t damage;
+    if (shadow.valid) {
+        pixman_region32_init(&damage);
+        pixman_region32_intersect_rect(&damage, &output.damage->current, 0, 0, width, height);
+    } else {
+        pixman_region32_init_rect(&damage, 0, 0, width, height);
+    }
+
+    if (!pixman_region32_not_empty(&damage)) {
+        pixman_region32_fini(&damage);
+        shadow.valid = true;
+        return shadow.texture;
+    }
+
+    pixman_image_set_clip_region32(shadow.image, &damage);
+
+    if (clear_color != nullptr) {
+        pixman_color_t color = to_pixman_color(*clear_color);
+        int rects_number;
+        pixman_box32_t* rects = pixman_region32_rectangles(&damage, &rects_number);
+        pixman_image_fill_boxes(PIXMAN_OP_SRC, shadow.image, &color, rects_number, rects);
+    }
+
+    for (const auto& item : std::span { render_list }.first(composited)) {
+        if (item.box.width <= 0 || item.box.height <= 0) {
+            continue;
+        }
+
+        if (item.texture == nullptr) {
+            pixman_color_t color = to_pixman_color(item.color);
+            pixman_image_t* fill = pixman_image_create_solid_fill(&color);
+            pixman_image_composite32(PIXMAN_OP_OVER, fill, nullptr, shadow.image, 0, 0, 0, 0, item.box.x, item.box.y, item.box.width, item.box.height);
+            pixman_image_unref(fill);
+            continue;
+        }
+
+        pixman_image_t* source = surfaces[item.surface];
+        int source_width = pixman_image_get_width(source);
+        int source_height = pixman_image_get_height(source);
+
+        // HiDPI buffers and outputs
+        bool scaled = source_width != item.box.width || source_height != item.box.height;
+        if (scaled) {
+            struct pixman_transform transform;
+            pixman_transform_init_scale(&transform,
+                                        pixman_double_to_fixed(static_cast<double>(source_width) / item.box.width),
+                                        pixman_double_to_fixed(static_cast<double>(source_height) / item.box.height));
+            pixman_image_set_transform(source, &transform);
+            pixman_image_set_filter(source, PIXMAN_FILTER_BILINEAR, nullptr, 0);
+        }
+
+        pixman_image_composite32(PIXMAN_OP_OVER, source, nullptr, shadow.image, 0, 0, 0, 0, item.box.x, item.box.y, item.box.width, item.box.height);
+
+        if (scaled) {
+            pixman_image_set_transform(source, nullptr);
+            pixman_image_set_filter(source, PIXMAN_FILTER_FAST, nullptr, 0);
+        }
+    }
+
+    pixman_image_set_clip_region32(shadow.image, nullptr);
+
+    // upload only what changed
+    auto* data = reinterpret_cast<const uint8_t*>(pixman_image_get_data(shadow.image));
+    int stride = pixman_image_get_stride(shadow.image);
+    int rects_number;
+    pixman_box32_t* rects = pixman_region32_rectangles(&damage, &rects_number);
+    for (int i = 0; i < rects_number; i++) {
+        wlr_texture_write_pixels(shadow.texture,
+                                 stride,
+                                 rects[i].x2 - rects[i].x1,
+                                 rects[i].y2 - rects[i].y1,
+                                 rects[i].x1,
+                                 rects[i].y1,
+                                 rects[i].x1,
+                                 rects[i].y1,
+                                 data);
+    }
+
+    pixman_region32_fini(&damage);
+    shadow.valid = true;
+    return shadow.texture;
+}
@@ -0,0 +1,94 @@
+#ifndef CARDBOARD_SOFTWARE_RENDERER_H_INCLUDED
+#define CARDBOARD_SOFTWARE_RENDERER_H_INCLUDED
+
+#include <pixman.h>
+
+#include <array>
+#include <list>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * \file
+ * \brief Compositing on the CPU with pixman, for machines without a GPU.
+ *
+ * There, the renderer of wlroots is OpenGL emulated by llvmpipe, which is expensive to draw each surface with.
+ */
+
+struct Output;
+struct RenderItem;
+struct wlr_renderer;
+struct wlr_surface;
+struct wlr_texture;
+
+/// The environment variable that enables the software renderer when set to \c 1.
+const std::string_view SOFTWARE_RENDERING_ENV = "CARDBOARD_SOFTWARE_RENDERING";
+
+/**
+ * \brief Composites the frames of the outputs on the CPU.
+ *
+ * Every output has a shadow buffer in memory that holds its last frame. Only the parts of it that changed since
+ * then are composited again, from copies of the shared memory buffers of the clients. The shadow buffer is then
+ * uploaded to a texture, which the renderer of wlroots draws where the output buffer is damaged,
+ * with a single quad per damaged rectangle.
+ *
+ * wlroots 0.10 can't draw into the output buffer from the CPU, hence the upload.
+ */
+class SoftwareRenderer {
+public:
+    SoftwareRenderer() = default;
+    ~SoftwareRenderer();
+    SoftwareRenderer(const SoftwareRenderer&) = delete;
+    SoftwareRenderer& operator=(const SoftwareRenderer&) = delete;
+
+    /**
+     * \brief Copies the part of the buffer of \a surface that changed with its last commit.
+     *
+     * Runs on every commit: wlroots has already released the buffer, but the client can't reuse it
+     * before it gets the release event. So the buffer can't be copied later, when it's needed.
+     *
+     * Surfaces that aren't in the render list of any of \a outputs aren't copied, their copy is dropped instead.
+     * Until they commit again once shown, composite() leaves them, and what is over them, to the renderer.
+     */
+    void commit_surface(struct wlr_surface* surface, const std::list<Output>& outputs);
+    /// Forgets the copy of the buffer of \a surface.
+    void destroy_surface(struct wlr_surface* surface);
+    /// Frees the shadow buffer of \a output.
+    void destroy_output(Output& output);
+
+    /**
+     * \brief Composites \a render_list in the shadow buffer of \a output and uploads it.
+     *
+     * \a clear_color fills the background, unless it's null.
+     *
+     * Items that can't be composited on the CPU, like surfaces without a shared memory buffer, have to be drawn
+     * by the renderer, and so do the ones over them. \a composited is set to the number of items in the texture,
+     * the renderer draws the rest of \a render_list over it.
+     *
+     * \returns the texture to draw the frame with, or null if no item could be composited.
+     */
+    struct wlr_texture* composite(struct wlr_renderer* renderer, Output& output, const std::vector<RenderItem>& render_list, const std::array<float, 4>* clear_color, size_t& composited);
+
+private:
+    struct ShadowBuffer {
+        pixman_image_t* image = nullptr;
+        struct wlr_texture* texture = nullptr;
+        /// False if the frames since the last composited one were drawn otherwise.
+        bool valid = false;
+        /// How many items of the render list are in #image, and the surface of the item after them.
+        size_t composited = 0;
+        struct wlr_surface* first_left = nullptr;
+    };
+
+    /// Copies of the last buffer of the surfaces, null for the surfaces that were hidden when they committed.
+    std::unordered_map<struct wlr_surface*, pixman_image_t*> surfaces;
+    std::unordered_map<Output*, ShadowBuffer> outputs;
+
+    static void destroy_shadow_buffer(ShadowBuffer& shadow);
+};
+
+using SoftwareRendererInstance = std::unique_ptr<SoftwareRenderer>;
+
+#endif // CARDBOARD_SOFTWARE_RENDERER_H_INCLUDED
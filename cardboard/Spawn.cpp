@@ -1,35 +1,54 @@
+extern "C" {
+#include <wlr/util/log.h>
+}
+
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "Server.h"
 #include "Spawn.h"
 
-template <typename... Args>
-static void ignore(Args&&...)
+tl::expected<pid_t, std::error_code> spawn(Server& server, const std::vector<std::string>& argv)
 {
-}
+    if (argv.empty()) {
+        return tl::unexpected(std::make_error_code(std::errc::invalid_argument));
+    }
 
-std::error_code spawn(std::function<int()> fn)
-{
-    // credits: http://www.lubutu.com/code/spawning-in-unix
-    int fd[2];
-    if (pipe(fd) == -1) {
-        int err = errno;
-        return std::error_code(err, std::generic_category());
+    std::vector<char*> c_argv;
+    c_argv.reserve(argv.size() + 1);
+    for (const auto& arg : argv) {
+        // posix_spawn doesn't modify its arguments, the signature is only for compatibility with old code
+        c_argv.push_back(const_cast<char*>(arg.c_str()));
     }
-    if (fork() == 0) {
-        close(fd[0]);
-        fcntl(fd[1], F_SETFD, FD_CLOEXEC);
+    c_argv.push_back(nullptr);
+
+    posix_spawnattr_t attributes;
+    posix_spawnattr_init(&attributes);
 
-        setsid();
-        int status = fn();
+    // the compositor blocks SIGCHLD for the event loop and ignores SIGPIPE, don't pass that on
+    sigset_t mask;
+    sigemptyset(&mask);
+    posix_spawnattr_setsigmask(&attributes, &mask);
 
-        ignore(write(fd[1], &errno, sizeof(errno)));
-        exit(status);
+    sigset_t defaults;
+    sigemptyset(&defaults);
+    for (int signal_number : { SIGCHLD, SIGPIPE, SIGINT, SIGHUP, SIGTERM }) {
+        sigaddset(&defaults, signal_number);
     }
+    posix_spawnattr_setsigdefault(&attributes, &defaults);
 
-    close(fd[1]);
+    posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSID);
 
-    int code = 0;
-    if (!read(fd[0], &code, sizeof(code))) {
-        code = 0;
+    pid_t pid;
+    int error = posix_spawnp(&pid, c_argv[0], nullptr, &attributes, c_argv.data(), environ);
+    posix_spawnattr_destroy(&attributes);
+
+    if (error != 0) {
+        return tl::unexpected(std::error_code(error, std::generic_category()));
     }
-    close(fd[0]);
-    return std::error_code(code, std::generic_category());
+
+    server.children.insert({ pid, argv[0] });
+    return pid;
 }
@@ -1,11 +1,13 @@
 #ifndef CARDBOARD_SPAWN_H_INCLUDED
 #define CARDBOARD_SPAWN_H_INCLUDED
 
-#include <functional>
+#include <string>
 #include <system_error>
+#include <vector>
 
-#include <fcntl.h>
-#include <unistd.h>
+#include <sys/types.h>
+
+#include <tl/expected.hpp>
 
 /**
  * \file
@@ -13,15 +15,21 @@
  * a system utility in another process.
  */
 
+struct Server;
+
 /**
- * \brief Executes the function \a fn in a new process, in background.
- * \a fn should call a function from the \c exec(3) family.
+ * \brief Executes the program \a argv[0] with the arguments \a argv, in a new process, in background.
+ *
+ * The program is looked up in \c PATH if its name doesn't contain a slash. It runs in a new session,
+ * with an empty signal mask and the default signal handlers.
  *
- * If any library call from \a fn encounters an error (especially the exec function),
- * it is caught by the parent and returned by this function.
+ * The process is created with \c posix_spawn, which doesn't copy the address space of the compositor
+ * like \c fork does and only suspends it until the child calls \c exec. If \c exec fails, the error is
+ * returned by this function. Otherwise, the child is remembered in Server::children and how it exits
+ * is logged when it is reaped, from the event loop.
  *
- * \returns The errno value if something failed, or 0 if successful.
+ * \returns The pid of the child, or the error that kept it from running.
  * */
-std::error_code spawn(std::function<int()> fn);
+tl::expected<pid_t, std::error_code> spawn(Server& server, const std::vector<std::string>& argv);
 
 #endif // CARDBOARD_SPAWN_H_INCLUDED
@@ -0,0 +1,55 @@
+#ifndef CARDBOARD_STATS_H_INCLUDED
+#define CARDBOARD_STATS_H_INCLUDED
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+/**
+ * \brief Durations of the hot paths of the compositor, recorded for benchmarks.
+ *
+ * Nothing is recorded unless Server::stats points to an instance.
+ */
+struct Stats {
+    using Clock = std::chrono::steady_clock;
+    using Samples = std::vector<Clock::duration>;
+
+    Samples frame; ///< Output::frame_handler
+    Samples arrange; ///< Workspace::arrange_workspace
+    Samples hit_test; ///< SurfaceManager::get_surface_under_cursor, on pointer motion
+
+    /// Surfaces drawn by Output::frame_handler, over all frames.
+    uint64_t rendered_surfaces = 0;
+    /// Surfaces skipped by Output::frame_handler because they were off the output or occluded, over all frames.
+    uint64_t culled_surfaces = 0;
+    /// Frame callbacks sent by Server::hidden_frame_done_handler to surfaces that weren't drawn.
+    uint64_t throttled_frame_done = 0;
+};
+
+/// Records the time spent in the enclosing scope into \a stats, if not null.
+class ScopedTimer {
+public:
+    ScopedTimer(Stats* stats, Stats::Samples Stats::*samples)
+        : samples(stats ? &(stats->*samples) : nullptr)
+    {
+        if (this->samples) {
+            begin = Stats::Clock::now();
+        }
+    }
+
+    ~ScopedTimer()
+    {
+        if (samples) {
+            samples->push_back(Stats::Clock::now() - begin);
+        }
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    Stats::Samples* samples;
+    Stats::Clock::time_point begin;
+};
+
+#endif // CARDBOARD_STATS_H_INCLUDED
@@ -1,3 +1,10 @@
+extern "C" {
+#include <wlr/util/log.h>
+}
+
+#include <cinttypes>
+#include <tuple>
+
 #include "SurfaceManager.h"
 #include "Server.h"
 
@@ -11,6 +18,12 @@ void SurfaceManager::map_view(Server& server, View& view)
     server.seat.get_focused_workspace(server).and_then([&server, &view, prev_focused](auto& ws) {
         ws.add_view(*(server.output_manager), view, prev_focused);
     });
+    broadcast_event(server,
+                    {
+                        .type = libcardboard::ipc::EventType::ViewMapped,
+                        .workspace = static_cast<int32_t>(view.workspace_id),
+                        .view = view.id,
+                    });
     server.seat.focus_view(server, view);
 }
 
@@ -21,6 +34,22 @@ void SurfaceManager::unmap_view(Server& server, View& view)
         server.output_manager->get_view_workspace(view).remove_view(*(server.output_manager), view);
     }
 
+    wlr_log(WLR_DEBUG,
+            "view %p unmapped, resizes: %" PRIu64 " requested, %" PRIu64 " suppressed, %" PRIu64 " coalesced, %" PRIu64 " sent, %" PRIu64 " timed out",
+            static_cast<void*>(&view),
+            view.resize_counters.requested,
+            view.resize_counters.suppressed,
+            view.resize_counters.coalesced,
+            view.resize_counters.sent,
+            view.resize_counters.timed_out);
+
+    broadcast_event(server,
+                    {
+                        .type = libcardboard::ipc::EventType::ViewUnmapped,
+                        .workspace = static_cast<int32_t>(view.workspace_id),
+                        .view = view.id,
+                    });
+
     server.seat.hide_view(server, view);
     server.seat.remove_from_focus_stack(view);
 }
@@ -36,7 +65,7 @@ void SurfaceManager::remove_view(ViewAnimation& view_animation, View& view)
     views.remove_if([&view](const auto& other) { return &view == other.get(); });
 }
 
-OptionalRef<View> SurfaceManager::get_surface_under_cursor(OutputManager& output_manager, double lx, double ly, struct wlr_surface*& surface, double& sx, double& sy)
+OptionalRef<View> SurfaceManager::get_surface_under_cursor(OutputManager& output_manager, ViewAnimation& view_animation, double lx, double ly, struct wlr_surface*& surface, double& sx, double& sy)
 {
     OptionalRef<Output> output = output_manager.get_output_at(lx, ly);
     const auto ws_it = std::find_if(output_manager.workspaces.begin(), output_manager.workspaces.end(), [output](const auto& other) {
@@ -95,8 +124,15 @@ OptionalRef<View> SurfaceManager::get_surface_under_cursor(OutputManager& output
     }
 
     // fourth, regular, tiled views
-    for (auto& column : ws_it->columns) {
-        for (auto& tile : column.tiles) {
+    // only the columns around the cursor can be under it, unless views are moving or have popups
+    size_t first_column = 0, last_column = ws_it->columns.size();
+    if (mapped_view_popups == 0 && !view_animation.is_animating()) {
+        if (auto column_range = ws_it->find_columns_at(output_manager, lx); column_range) {
+            std::tie(first_column, last_column) = *column_range;
+        }
+    }
+    for (size_t i = first_column; i < last_column; i++) {
+        for (auto& tile : ws_it->columns[i].tiles) {
             NotNullPointer<View> view = tile.view;
             if (!view->mapped) {
                 continue;
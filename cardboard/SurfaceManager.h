@@ -20,6 +20,8 @@ struct SurfaceManager {
     std::list<std::unique_ptr<XwaylandORSurface>> xwayland_or_surfaces;
 #endif
     LayerArray layers;
+    /// Number of mapped popups of views. Popups can reach over other views, so hit-testing can't skip views while there are any.
+    int mapped_view_popups = 0;
 
     /// Common mapping procedure for views regardless of their underlying shell.
     void map_view(Server&, View&);
@@ -39,7 +41,7 @@ struct SurfaceManager {
      * \param[out] sx The x coordinate of the found surface in root coordinates.
      * \param[out] sy The y coordinate of the found surface in root coordinates.
      */
-    OptionalRef<View> get_surface_under_cursor(OutputManager&, double lx, double ly, struct wlr_surface*& surface, double& sx, double& sy);
+    OptionalRef<View> get_surface_under_cursor(OutputManager&, ViewAnimation&, double lx, double ly, struct wlr_surface*& surface, double& sx, double& sy);
 };
 
 #endif // CARDBOARD_VIEW_MANAGER_H_INCLUDED
@@ -13,6 +13,13 @@ extern "C" {
 #include "Server.h"
 #include "View.h"
 
+View::~View()
+{
+    if (deferred_size_timer != nullptr) {
+        wl_event_source_remove(deferred_size_timer);
+    }
+}
+
 OptionalRef<Output> View::get_views_output(Server& server)
 {
     if (workspace_id < 0) {
@@ -87,12 +94,85 @@ void View::resize(int width, int height)
 {
     target_width = width;
     target_height = height;
+    resize_counters.requested++;
+
+    const std::pair size = { width, height };
+    if (is_size_in_flight()) {
+        // wait for the client to catch up, keeping only the latest size
+        if (size == requested_size) {
+            deferred_size = std::nullopt;
+            resize_counters.suppressed++;
+        } else {
+            if (deferred_size) {
+                resize_counters.coalesced++;
+            }
+            if (!deferred_size && event_loop != nullptr) {
+                // don't wait forever on clients that hang
+                if (deferred_size_timer == nullptr) {
+                    deferred_size_timer = wl_event_loop_add_timer(event_loop, View::deferred_size_timeout_handler, this);
+                }
+                wl_event_source_timer_update(deferred_size_timer, SIZE_ANSWER_TIMEOUT);
+            }
+            deferred_size = size;
+        }
+        return;
+    }
+
+    deferred_size = std::nullopt;
+    configure_size(width, height);
+}
+
+void View::size_answered()
+{
+    if (!deferred_size) {
+        return;
+    }
+
+    if (deferred_size_timer != nullptr) {
+        wl_event_source_timer_update(deferred_size_timer, 0);
+    }
+
+    auto [width, height] = *deferred_size;
+    deferred_size = std::nullopt;
+    configure_size(width, height);
+}
+
+void View::configure_size(int width, int height)
+{
+    const std::pair size = { width, height };
+    if (size == requested_size && geometry.width == width && geometry.height == height) {
+        resize_counters.suppressed++;
+        return;
+    }
+
+    requested_size = size;
+    if (send_size(width, height)) {
+        resize_counters.coalesced++;
+    } else {
+        resize_counters.sent++;
+    }
+}
+
+int View::deferred_size_timeout_handler(void* data)
+{
+    auto* view = static_cast<View*>(data);
+    if (!view->deferred_size) {
+        return 0;
+    }
+
+    view->resize_counters.timed_out++;
+    auto [width, height] = *view->deferred_size;
+    view->deferred_size = std::nullopt;
+    view->configure_size(width, height);
+
+    return 0;
 }
 
 void create_view(Server& server, NotNullPointer<View> view_)
 {
     server.surface_manager.views.emplace_back(view_);
     auto* view = server.surface_manager.views.back().get();
+    view->event_loop = server.event_loop;
 
     view->prepare(server);
 }
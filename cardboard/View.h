@@ -8,6 +8,8 @@ extern "C" {
 #include <wlr/types/wlr_xdg_shell.h>
 }
 
+#include <array>
+#include <cstdint>
 #include <list>
 #include <optional>
 #include <utility>
@@ -53,7 +55,7 @@ public:
         RECOVERING,
         FULLSCREEN,
     };
-    virtual ~View() = default;
+    virtual ~View();
     /**
      * \brief The size and offset of the usable working area.
      *
@@ -102,6 +104,38 @@ public:
     bool mapped;
     bool new_view; ///< True if the view didn't have its first map.
 
+    /**
+     * \brief Identifies the view to IPC clients, in events and queries.
+     *
+     * Views are numbered from 1 in the order they are created, and numbers aren't reused.
+     */
+    const uint64_t id = ++last_id;
+
+    /// Counts what happened to the size requests made through resize().
+    struct ResizeCounters {
+        uint64_t requested = 0; ///< calls to resize()
+        uint64_t suppressed = 0; ///< requests dropped because the client already has, or is about to get, that size
+        uint64_t coalesced = 0; ///< requests replaced by a newer one before reaching the client
+        uint64_t sent = 0; ///< sizes sent to the client
+        uint64_t timed_out = 0; ///< deferred sizes sent without waiting, because the client didn't answer in time
+    } resize_counters;
+
+    /// The event loop of the server, set by create_view. Null for views that aren't registered.
+    struct wl_event_loop* event_loop = nullptr;
+
+    /**
+     * \brief The projection matrix of the toplevel surface when it was last drawn.
+     *
+     * It's reused while the surface is drawn at the same place, with the same transform, on an output with
+     * the same transform matrix.
+     */
+    struct RenderMatrixCache {
+        struct wlr_box box = {};
+        enum wl_output_transform transform = WL_OUTPUT_TRANSFORM_NORMAL;
+        std::array<float, 9> output_transform_matrix = {};
+        std::array<float, 9> matrix = {};
+    } render_matrix_cache;
+
     /// Get the top level surface of this view.
     virtual struct wlr_surface* get_surface() = 0;
 
@@ -118,8 +152,13 @@ public:
      */
     virtual bool get_surface_under_coords(double lx, double ly, struct wlr_surface*& surface, double& sx, double& sy) = 0;
 
-    /// Requests the resize to the client. Do not assume that the client is resized afterwards.
-    virtual void resize(int width, int height);
+    /**
+     * \brief Requests the resize to the client. Do not assume that the client is resized afterwards.
+     *
+     * Sizes that the client already has or has just been sent are not sent again. While the client
+     * hasn't answered the previous size, only the latest request is kept and sent after the answer.
+     */
+    void resize(int width, int height);
 
     /// Requests the move to the client. Do not assume that the client is resized afterwards.
     virtual void move(int x, int y);
@@ -162,6 +201,37 @@ public:
     /// Returns true if the view is mapped and in not fullscreen state.
     bool is_mapped_and_normal();
 
+protected:
+    /// The size last sent to the client.
+    std::optional<std::pair<int, int>> requested_size;
+    /// The size to send once the client answers the size in flight.
+    std::optional<std::pair<int, int>> deferred_size;
+    /// Sends the deferred size anyway if the client doesn't answer within SIZE_ANSWER_TIMEOUT. Null until a size is deferred.
+    struct wl_event_source* deferred_size_timer = nullptr;
+
+    /**
+     * \brief Sends the size to the client.
+     *
+     * \returns \c true if the size was merged into a configure that hasn't reached the client yet.
+     */
+    virtual bool send_size(int width, int height) = 0;
+
+    /// Returns true if the client didn't yet answer the last size it was sent.
+    virtual bool is_size_in_flight() = 0;
+
+    /// To be called by shells when the client answers the size in flight. Sends the deferred size, if any.
+    void size_answered();
+
+private:
+    /// The id of the last created view.
+    inline static uint64_t last_id = 0;
+
+    /// Sends the size to the client, unless the client already has it.
+    void configure_size(int width, int height);
+
+    /// Called when the client didn't answer the size in flight in time. Sends the deferred size.
+    static int deferred_size_timeout_handler(void* data);
+
 protected:
     View()
         : geometry { 0, 0, 0, 0 }
@@ -177,6 +247,9 @@ protected:
     }
 };
 
+/// Milliseconds to wait for a client to answer a size before sending it a newer one anyway.
+const int SIZE_ANSWER_TIMEOUT = 500;
+
 /// Registers a view to the server and attaches the event handlers.
 void create_view(Server& server, NotNullPointer<View> view);
 
@@ -1,9 +1,12 @@
 #include "ViewAnimation.h"
 
+#include <algorithm>
+
 #include "Server.h"
 
-ViewAnimation::ViewAnimation(AnimationSettings settings)
-    : settings { settings }
+ViewAnimation::ViewAnimation(Server* server, AnimationSettings settings)
+    : server { server }
+    , settings { settings }
 {
 }
 
@@ -15,8 +18,14 @@ void ViewAnimation::enqueue_task(const AnimationTask& task)
         task.view->y,
         task.target_x,
         task.target_y,
-        std::chrono::high_resolution_clock::now(),
+        Clock::now(),
         task.animation_finished_callback);
+
+    if (auto output = task.view->get_views_output(*server); output) {
+        output_schedule_frame(output.unwrap());
+    } else {
+        wl_event_source_timer_update(event_source, settings.ms_per_frame);
+    }
 }
 
 void ViewAnimation::cancel_tasks(View& view)
@@ -24,8 +33,10 @@ void ViewAnimation::cancel_tasks(View& view)
     for (auto& task : tasks) {
         if (task.view == &view) {
             task.cancelled = true;
+            output_damage_view(*server, *task.view, true);
             task.view->x = task.view->target_x;
             task.view->y = task.view->target_y;
+            output_damage_view(*server, *task.view, true);
         }
     }
 }
@@ -36,31 +47,43 @@ static float beziere_blend(float t)
     return t * t * (3.0f - 2.0f * t);
 }
 
-int ViewAnimation::timer_callback(void* data)
+bool ViewAnimation::advance_tasks(OptionalRef<Output> output, Clock::time_point time)
 {
-    auto* view_animation = static_cast<ViewAnimation*>(data);
-
-    auto current_time = std::chrono::high_resolution_clock::now();
-    auto tasks_number = view_animation->tasks.size();
+    bool running = false;
+    auto tasks_number = tasks.size();
     for (size_t i = 0; i < tasks_number; i++) {
-        auto task = view_animation->tasks.front();
-        view_animation->tasks.pop_front();
+        auto task = tasks.front();
+        tasks.pop_front();
 
+        // the view of a cancelled task may be gone already
         if (task.cancelled) {
             continue;
         }
 
-        auto interval = std::chrono::duration_cast<std::chrono::milliseconds>(
-            current_time - task.begin);
-        float completeness = static_cast<float>(interval.count()) / view_animation->settings.animation_duration;
+        if (auto task_output = task.view->get_views_output(*server); task_output != output) {
+            // the view might have changed its output since the last step, make sure it's still driven
+            if (task_output) {
+                output_schedule_frame(task_output.unwrap());
+            } else {
+                wl_event_source_timer_update(event_source, settings.ms_per_frame);
+            }
+            tasks.push_back(task);
+            continue;
+        }
+
+        auto interval = std::chrono::duration_cast<std::chrono::milliseconds>(time - task.begin);
+        float completeness = static_cast<float>(interval.count()) / settings.animation_duration;
 
         float multiplier = beziere_blend(completeness);
+        output_damage_view(*server, *task.view, true);
         task.view->move(
             task.startx - multiplier * (task.startx - task.targetx),
             task.starty - multiplier * (task.starty - task.targety));
+        output_damage_view(*server, *task.view, true);
 
         if (completeness < 0.999) { // animation incomplete;
-            view_animation->tasks.push_back(task);
+            tasks.push_back(task);
+            running = true;
         } else {
             if (task.animation_finished_callback) {
                 task.animation_finished_callback();
@@ -68,16 +91,37 @@ int ViewAnimation::timer_callback(void* data)
         }
     }
 
-    wl_event_source_timer_update(view_animation->event_source, view_animation->settings.ms_per_frame);
+    return running;
+}
+
+bool ViewAnimation::is_animating() const
+{
+    // cancelled tasks stay queued until the next step, they animate nothing
+    return std::any_of(tasks.begin(), tasks.end(), [](const Task& task) { return !task.cancelled; });
+}
+
+void ViewAnimation::tick(Output& output, Clock::time_point time)
+{
+    if (advance_tasks(output, time)) {
+        output_schedule_frame(output);
+    }
+}
+
+int ViewAnimation::timer_callback(void* data)
+{
+    auto* view_animation = static_cast<ViewAnimation*>(data);
+
+    if (view_animation->advance_tasks(NullRef<Output>, Clock::now())) {
+        wl_event_source_timer_update(view_animation->event_source, view_animation->settings.ms_per_frame);
+    }
     return 0;
 }
 
 ViewAnimationInstance create_view_animation(Server* server, AnimationSettings settings)
 {
-    auto view_animation = std::make_unique<ViewAnimation>(ViewAnimation { settings });
+    auto view_animation = std::make_unique<ViewAnimation>(ViewAnimation { server, settings });
+    // armed only when there are views to animate outside of any output
     view_animation->event_source = wl_event_loop_add_timer(server->event_loop, ViewAnimation::timer_callback, view_animation.get());
 
-    wl_event_source_timer_update(view_animation->event_source, settings.ms_per_frame);
-
     return view_animation;
 }
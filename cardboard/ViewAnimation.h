@@ -9,8 +9,10 @@ extern "C" {
 #include <deque>
 #include <memory>
 
+#include "OptionalRef.h"
 #include "View.h"
 
+struct Output;
 struct Server;
 
 class ViewAnimation;
@@ -24,29 +26,43 @@ struct AnimationTask {
 };
 
 struct AnimationSettings {
+    /// Interval of the fallback timer that animates views which are not shown on any output.
     int ms_per_frame;
     int animation_duration; //ms
 };
 
+/**
+ * \brief Moves views smoothly towards their target coordinates.
+ *
+ * Animations are advanced by the frame handler of the output each view is shown on, using the time
+ * the frame is expected to be presented at, so they run at the refresh rate of that output.
+ * Views that are not on any output are advanced by a timer, which is disarmed when there is nothing to animate.
+ */
 class ViewAnimation {
-    ViewAnimation(AnimationSettings);
+    ViewAnimation(Server*, AnimationSettings);
 
 public:
+    using Clock = std::chrono::steady_clock;
+
     void enqueue_task(const AnimationTask&);
     /// Cancel animation tasks for the given view and warp it to its target coords.
     void cancel_tasks(View&);
+    /// Advances the animations of the views shown on \a output, for a frame presented at \a time.
+    void tick(Output& output, Clock::time_point time);
+    /// Returns true if any view is being animated, i.e. it is not at its target coords.
+    bool is_animating() const;
 
 private:
     struct Task {
         View* view;
         int startx, starty;
         int targetx, targety;
-        std::chrono::time_point<std::chrono::high_resolution_clock> begin;
+        Clock::time_point begin;
         std::function<void()> animation_finished_callback;
         bool cancelled;
 
         // aggregate initialization not working wtf
-        Task(View* view, int startx, int starty, int targetx, int targety, std::chrono::time_point<std::chrono::high_resolution_clock> begin, std::function<void()> animation_finished_callback)
+        Task(View* view, int startx, int starty, int targetx, int targety, Clock::time_point begin, std::function<void()> animation_finished_callback)
             : view(view)
             , startx(startx)
             , starty(starty)
@@ -61,8 +77,12 @@ private:
 
     std::deque<Task> tasks;
 
+    Server* server;
     wl_event_source* event_source;
     AnimationSettings settings;
+
+    /// Advances the tasks of the views shown on \a output. Returns true if any of them is still running.
+    bool advance_tasks(OptionalRef<Output> output, Clock::time_point time);
     static int timer_callback(void* data);
     friend ViewAnimationInstance create_view_animation(Server* server, AnimationSettings);
 };
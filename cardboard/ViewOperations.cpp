@@ -66,7 +66,9 @@ void reconfigure_view_position(Server& server, View& view, int x, int y, bool an
 
         scroll_workspace(*(server.output_manager), workspace, RelativeScroll { dx }, animate);
     } else {
+        output_damage_view(server, view, true);
         view.move(x, y);
+        output_damage_view(server, view, true);
         update_view_workspace(server, view);
     }
 }
@@ -4,10 +4,14 @@ extern "C" {
 
 #include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <limits>
+#include <optional>
 #include <unordered_set>
 
 #include "OptionalRef.h"
 #include "Output.h"
+#include "Stats.h"
 #include "View.h"
 #include "ViewOperations.h"
 #include "Workspace.h"
@@ -62,14 +66,30 @@ Workspace::Column::MappedAndNormal::IteratorWrapper Workspace::Column::MappedAnd
     return Workspace::Column::MappedAndNormal::IteratorWrapper { .tile_list = tile_list, .it = tile_list->end() };
 }
 
-std::list<Workspace::Column>::iterator Workspace::find_column(View* view)
+std::vector<Workspace::Column>::iterator Workspace::find_column(View* view)
 {
-    return std::find_if(columns.begin(), columns.end(), [view](const auto& column) {
-        return std::find_if(column.tiles.begin(), column.tiles.end(), [view](const auto& tile) {
-                   return tile.view == view;
-               })
-            != column.tiles.end();
-    });
+    // view can be null, but null is never a key of the index
+    if (auto it = tile_index.find(view); it != tile_index.end()) {
+        return columns.begin() + it->second.column;
+    }
+
+    return columns.end();
+}
+
+void Workspace::update_tile_index(size_t first_column)
+{
+    for (size_t i = first_column; i < columns.size(); i++) {
+        for (size_t j = 0; j < columns[i].tiles.size(); j++) {
+            tile_index[columns[i].tiles[j].view] = { i, j };
+        }
+    }
+
+    invalidate_layout(first_column);
+}
+
+void Workspace::invalidate_layout(size_t first_column)
+{
+    first_dirty_column = std::min(first_dirty_column, first_column);
 }
 
 std::list<NotNullPointer<View>>::iterator Workspace::find_floating(View* view)
@@ -102,7 +122,9 @@ void Workspace::add_view(OutputManager& output_manager, View& view, View* next_t
         }
 
         auto new_it = columns.emplace(it);
-        new_it->tiles.push_back({ &view, &*new_it });
+        new_it->tiles.push_back({ &view });
+        // the columns on the right have been shifted
+        update_tile_index(std::distance(columns.begin(), new_it));
     }
 
     if (!transferring) {
@@ -127,13 +149,17 @@ void Workspace::remove_view(OutputManager& output_manager, View& view, bool tran
         view.change_output(output, NullRef<Output>);
     }
 
-    auto column_it = find_column(&view);
-    if (column_it != columns.end()) {
-        column_it->tiles.remove_if([&view](auto& other) { return other.view == &view; });
+    if (auto index_it = tile_index.find(&view); index_it != tile_index.end()) {
+        auto [column_index, tile_position] = index_it->second;
+        tile_index.erase(index_it);
+
+        auto& tiles = columns[column_index].tiles;
+        tiles.erase(tiles.begin() + tile_position);
         // destroy column if no tiles left
-        if (column_it->tiles.empty()) {
-            columns.erase(column_it);
+        if (tiles.empty()) {
+            columns.erase(columns.begin() + column_index);
         }
+        update_tile_index(column_index);
     }
     floating_views.remove(&view);
 
@@ -146,8 +172,18 @@ void Workspace::insert_into_column(OutputManager& output_manager, View& view, Co
     for (auto& tile : column.mapped_and_normal_tiles()) {
         max_width = std::max(max_width, tile.view->geometry.width);
     }
+    // removing the view may destroy its column and shift the others to the left
+    auto column_index = static_cast<size_t>(&column - columns.data());
+    if (auto view_column = find_column(&view); view_column != columns.end()
+        && view_column->tiles.size() == 1
+        && static_cast<size_t>(std::distance(columns.begin(), view_column)) < column_index) {
+        column_index--;
+    }
+
     remove_view(output_manager, view, true);
-    column.tiles.push_back({ &view, &column });
+    auto& tiles = columns[column_index].tiles;
+    tiles.push_back({ &view });
+    tile_index[&view] = { column_index, tiles.size() - 1 };
 
     // Match view's width with the rest of the column.
     // You might consider this a terrible hack. It makes arrange_workspace "think" that the view has been resized.
@@ -176,41 +212,80 @@ void Workspace::arrange_workspace(OutputManager& output_manager, bool animate)
     if (!output) {
         return;
     }
+    ScopedTimer timer(server->stats, &Stats::arrange);
 
-    int acc_width = 0;
     const struct wlr_box* output_box = output_manager.get_output_box(output.unwrap());
     const struct wlr_box& usable_area = output.unwrap().usable_area;
 
+    LayoutParameters parameters = {
+        .output_box = *output_box,
+        .usable_area = usable_area,
+        .gap = server->config.gap,
+    };
+    // moving everything repaints everything, else only the columns that are laid out again are repainted
+    bool damage_whole = fullscreen_view || scroll_x != arranged_scroll_x;
+    arranged_scroll_x = scroll_x;
+    if (!layout_parameters || memcmp(&*layout_parameters, &parameters, sizeof(LayoutParameters)) != 0) {
+        layout_parameters = parameters;
+        invalidate_layout();
+        damage_whole = true;
+    }
+
     fullscreen_view.and_then([output_box](auto& view) {
         view.move(output_box->x - view.geometry.x, output_box->y - view.geometry.y);
         view.resize(output_box->width, output_box->height);
     });
 
     // arrange tiles
-    for (auto& column : columns) {
-        // ignore columns that are not ready for tiling
-        bool should_skip = false;
+    int acc_width = 0;
+    // the left edge of the repainted part, in workspace coordinates, before and after the arrangement
+    std::optional<int> damage_wx;
+    for (size_t i = 0; i < columns.size(); i++) {
+        auto& column = columns[i];
+
         float scale_sum = 0; // sum of all weights for height calculation
+        int max_width = 0;
+        size_t mapped_tiles = 0;
+        bool tiles_changed = false;
         for (auto& tile : column.mapped_and_normal_tiles()) {
-            if (!tile.view->is_mapped_and_normal()) {
-                should_skip = true;
-            } else {
-                scale_sum += tile.vertical_scale;
-            }
+            scale_sum += tile.vertical_scale;
+            max_width = std::max(max_width, tile.view->geometry.width);
+            mapped_tiles++;
+            tiles_changed = tiles_changed || tile.vertical_scale != tile.layout.vertical_scale || tile.view->geometry.y != tile.layout.geometry_y;
         }
-        if (should_skip) {
-            continue;
+
+        // clients resize themselves and leave fullscreen on their own, which moves the columns on the right.
+        // the heights of the tiles and their vertical position depend on their scales and geometries
+        if (i < first_dirty_column && (tiles_changed || max_width != column.layout.width || mapped_tiles != column.layout.mapped_tiles)) {
+            first_dirty_column = i;
+        }
+
+        const bool dirty = i >= first_dirty_column;
+        if (dirty && !damage_wx) {
+            // columns that were never laid out have no previous position
+            const bool new_column = column.layout.width == 0 && column.layout.mapped_tiles == 0;
+            damage_wx = new_column ? acc_width : std::min(column.layout.wx, acc_width);
+        }
+        if (dirty) {
+            column.layout = {
+                .wx = acc_width,
+                .width = max_width,
+                .mapped_tiles = mapped_tiles,
+            };
         }
 
         int current_y = output_box->y + usable_area.y + server->config.gap;
-        int max_width = 0;
         for (auto& tile : column.mapped_and_normal_tiles()) {
             auto& view = *tile.view;
 
-            max_width = std::max(max_width, tile.view->geometry.width);
-
-            view.target_x = output_box->x + acc_width - view.geometry.x - scroll_x;
-            view.target_y = current_y - view.geometry.y;
+            view.target_x = output_box->x + column.layout.wx - view.geometry.x - scroll_x;
+            if (dirty) {
+                view.target_y = current_y - view.geometry.y;
+                tile.layout = {
+                    .vertical_scale = tile.vertical_scale,
+                    .geometry_y = view.geometry.y,
+                };
+            }
 
             if (animate && !suspend_animations) {
                 server->view_animation->enqueue_task({ tile.view,
@@ -221,16 +296,39 @@ void Workspace::arrange_workspace(OutputManager& output_manager, bool animate)
                 view.y = view.target_y;
             }
 
-            int height = static_cast<int>(
-                static_cast<float>(
-                    usable_area.height - (column.tiles.size() + 1) * server->config.gap)
-                * (tile.vertical_scale / scale_sum));
-            view.resize(view.geometry.width, height);
+            if (dirty) {
+                int height = static_cast<int>(
+                    static_cast<float>(
+                        usable_area.height - (column.tiles.size() + 1) * server->config.gap)
+                    * (tile.vertical_scale / scale_sum));
+                view.resize(view.geometry.width, height);
 
-            current_y += height + server->config.gap;
+                current_y += height + server->config.gap;
+            }
         }
 
-        acc_width += max_width + server->config.gap;
+        acc_width = column.layout.wx + max_width + server->config.gap;
+    }
+    // columns removed from the end leave nothing dirty, but their place has to be repainted
+    if (!damage_wx && first_dirty_column != std::numeric_limits<size_t>::max()) {
+        damage_wx = acc_width;
+    }
+    first_dirty_column = std::numeric_limits<size_t>::max();
+
+    if (damage_whole) {
+        output_damage_whole(output.unwrap());
+    } else if (damage_wx) {
+        // the dirty columns and whatever moved right of them, down to the edge of the output.
+        // Client side decorations can stick out of the column by a gap
+        const int x = output_box->x + *damage_wx - scroll_x - server->config.gap;
+        output_damage_box(*server,
+                          output.unwrap(),
+                          {
+                              .x = x,
+                              .y = output_box->y,
+                              .width = output_box->x + output_box->width - x,
+                              .height = output_box->height,
+                          });
     }
 }
 
@@ -362,6 +460,25 @@ int Workspace::get_view_wx(View& view)
     return acc_wx;
 }
 
+std::optional<std::pair<size_t, size_t>> Workspace::find_columns_at(OutputManager& output_manager, double lx)
+{
+    if (!output || !layout_parameters || first_dirty_column < columns.size()) {
+        return std::nullopt;
+    }
+
+    const struct wlr_box* output_box = output_manager.get_output_box(output.unwrap());
+    const double wx = lx - output_box->x + scroll_x;
+
+    // the positions of the columns are prefix sums, so they are sorted
+    auto it = std::upper_bound(columns.begin(), columns.end(), wx, [](double x, const Column& column) {
+        return x < column.layout.wx;
+    });
+    // the column under wx is the one before it
+    const size_t next = std::distance(columns.begin(), it);
+
+    return std::pair { next >= 2 ? next - 2 : 0, std::min(next + 1, columns.size()) };
+}
+
 void Workspace::set_fullscreen_view(OutputManager& output_manager, OptionalRef<View> view)
 {
     fullscreen_view.and_then([](auto& fview) {
@@ -383,6 +500,7 @@ void Workspace::set_fullscreen_view(OutputManager& output_manager, OptionalRef<V
     });
     fullscreen_view = view;
 
+    invalidate_layout();
     arrange_workspace(output_manager);
 }
 
@@ -404,6 +522,7 @@ void Workspace::activate(Output& new_output)
     }
 
     output = OptionalRef<Output>(new_output);
+    output_damage_whole(new_output);
 }
 
 void Workspace::deactivate()
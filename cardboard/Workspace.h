@@ -9,6 +9,7 @@ extern "C" {
 #include <algorithm>
 #include <list>
 #include <optional>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
@@ -39,9 +40,14 @@ struct Workspace {
     struct Column {
         struct Tile {
             NotNullPointer<View> view;
-            NotNullPointer<Column> column;
             /// This is initially 1. It represents the number of "parts" (as in "two parts water, one part sugar") when calculating the height of the tile relative to the column.
             float vertical_scale = 1.0f;
+
+            /// The values this tile was laid out with by the last Workspace::arrange_workspace.
+            struct Layout {
+                float vertical_scale = 0.0f;
+                int geometry_y = 0;
+            } layout = {};
         };
 
         /**
@@ -57,9 +63,9 @@ struct Workspace {
          */
         class MappedAndNormal {
         private:
-            NotNullPointer<std::list<Tile>> tile_list;
+            NotNullPointer<std::vector<Tile>> tile_list;
 
-            MappedAndNormal(NotNullPointer<std::list<Tile>> tile_list)
+            MappedAndNormal(NotNullPointer<std::vector<Tile>> tile_list)
                 : tile_list(tile_list)
             {
             }
@@ -67,8 +73,8 @@ struct Workspace {
         public:
             /// This quasi-iterator iterates over mapped and normal tiles.
             struct IteratorWrapper {
-                NotNullPointer<std::list<Tile>> tile_list;
-                std::list<Tile>::iterator it;
+                NotNullPointer<std::vector<Tile>> tile_list;
+                std::vector<Tile>::iterator it;
 
                 IteratorWrapper& operator++();
                 Tile& operator*();
@@ -81,15 +87,39 @@ struct Workspace {
             friend struct Column;
         };
 
-        std::list<Tile> tiles;
+        /// Tiles are stored contiguously, top to bottom.
+        std::vector<Tile> tiles;
+
+        /// The layout computed for this column by the last Workspace::arrange_workspace.
+        struct Layout {
+            /// Position of the column in workspace coordinates, i.e. the sum of the widths of the columns on its left.
+            int wx = 0;
+            int width = 0;
+            size_t mapped_tiles = 0;
+        } layout;
 
         MappedAndNormal mapped_and_normal_tiles();
         std::unordered_set<NotNullPointer<View>> get_mapped_and_normal_set();
     };
 
-    std::list<Column> columns;
+    /// Columns are stored contiguously, left to right, so that layout and rendering walk them linearly.
+    std::vector<Column> columns;
     std::list<NotNullPointer<View>> floating_views;
 
+    /// The position of a tiled view in #columns, as indices.
+    struct TileLocation {
+        size_t column;
+        size_t tile;
+    };
+
+    /**
+     * \brief Maps every tiled view of this workspace to its column and tile.
+     *
+     * Indices are the stable handles of tiles: any code that adds, removes or reorders
+     * columns or tiles must call #update_tile_index afterwards.
+     */
+    std::unordered_map<View*, TileLocation> tile_index;
+
     /**
      * \brief The output assigned to this workspace (or the output to which this workspace is assigned).
      *
@@ -112,11 +142,44 @@ struct Workspace {
     bool suspend_animations = false;
 
     /**
-     * \brief Returns an iterator to the column containing \a view.
+     * \brief Index of the first column whose layout has to be recomputed by #arrange_workspace.
+     *
+     * The columns on its left keep their position in the workspace and the sizes of their tiles,
+     * they are only translated when the viewport scrolls. The maximum value means that nothing changed
+     * since the last arrangement, not even columns removed from the end.
+     */
+    size_t first_dirty_column = 0;
+    /// #scroll_x at the last #arrange_workspace, scrolling moves every column.
+    std::optional<int> arranged_scroll_x;
+
+    /// The values that the whole layout depends on. If any of them changes, all the columns are dirty.
+    struct LayoutParameters {
+        struct wlr_box output_box;
+        struct wlr_box usable_area;
+        int gap;
+    };
+    std::optional<LayoutParameters> layout_parameters;
+
+    /**
+     * \brief Returns an iterator to the column containing \a view, in constant time.
      *
      * \param view - can be null!
      */
-    std::list<Column>::iterator find_column(View* view);
+    std::vector<Column>::iterator find_column(View* view);
+
+    /**
+     * \brief Rebuilds #tile_index for the columns starting at \a first_column.
+     *
+     * Columns to the left of \a first_column must not have been changed.
+     * The layout is invalidated starting at \a first_column as well.
+     */
+    void update_tile_index(size_t first_column = 0);
+
+    /**
+     * \brief Marks the columns starting at \a first_column as dirty, so that the next
+     * #arrange_workspace recomputes their position and resizes their tiles.
+     */
+    void invalidate_layout(size_t first_column = 0);
 
     /**
      * \brief Returns an iterator to the a floating view.
@@ -160,6 +223,9 @@ struct Workspace {
 
     /**
     * \brief Puts windows in tiled position and takes care of fullscreen views.
+    *
+    * Only the columns starting at #first_dirty_column are laid out again. The others are
+    * moved to follow the viewport, without sending them new sizes.
     */
     void arrange_workspace(OutputManager& output_manager, bool animate = true);
 
@@ -185,6 +251,18 @@ struct Workspace {
     */
     int get_view_wx(View&);
 
+    /**
+     * \brief Returns the range <tt>[first, last)</tt> of columns that can have surfaces at the x coordinate \a lx,
+     * in output layout coordinates.
+     *
+     * The column under \a lx is found by binary search over the positions computed by #arrange_workspace.
+     * Its neighbours are included too, as shadows and client side decorations can reach into the gaps.
+     * Returns \c std::nullopt if the layout is out of date.
+     *
+     * Tiles must be at their computed positions, i.e. not animated.
+     */
+    std::optional<std::pair<size_t, size_t>> find_columns_at(OutputManager& output_manager, double lx);
+
     /// Sets \a view as the currently fullscreen view. If null, the fullscreen view will be cleared, if any.
     void set_fullscreen_view(OutputManager& output_manager, OptionalRef<View> view);
 
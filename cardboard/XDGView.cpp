@@ -39,10 +39,24 @@ bool XDGView::get_surface_under_coords(double lx, double ly, struct wlr_surface*
     return false;
 }
 
-void XDGView::resize(int width, int height)
+bool XDGView::send_size(int width, int height)
 {
-    View::resize(width, height);
-    wlr_xdg_toplevel_set_size(xdg_surface, width, height);
+    // wlroots sends configures from an idle callback, one that is still queued is updated in place
+    bool merged = xdg_surface->configure_idle != nullptr;
+    if (uint32_t serial = wlr_xdg_toplevel_set_size(xdg_surface, width, height); serial != 0) {
+        configure_serial = serial;
+    } else if (xdg_surface->configure_idle == nullptr) {
+        // back to the size the client already has: wlroots cancelled the queued configure,
+        // its serial will never be acked
+        configure_serial = 0;
+    }
+
+    return merged;
+}
+
+bool XDGView::is_size_in_flight()
+{
+    return configure_serial != 0 && xdg_surface->configure_idle == nullptr;
 }
 
 void XDGView::prepare(Server& server)
@@ -152,6 +166,7 @@ static void create_xdg_popup(Server& server, struct wlr_xdg_popup* wlr_popup, No
                           { &popup->wlr_popup->base->events.destroy, &XDGPopup::destroy_handler },
                           { &popup->wlr_popup->base->events.new_popup, &XDGPopup::new_popup_handler },
                           { &popup->wlr_popup->base->events.map, &XDGPopup::map_handler },
+                          { &popup->wlr_popup->base->events.unmap, &XDGPopup::unmap_handler },
                       });
 
     popup->unconstrain(server);
@@ -197,6 +212,8 @@ void XDGView::surface_unmap_handler(struct wl_listener* listener, void*)
     auto* server = get_server(listener);
 
     server->surface_manager.unmap_view(*server, *view);
+    view->configure_serial = 0;
+    view->deferred_size = std::nullopt;
 
     for (auto* listener : view->map_unmap_listeners) {
         server->listeners.remove_listener(listener);
@@ -223,6 +240,13 @@ void XDGView::surface_commit_handler(struct wl_listener* listener, void*)
     auto* view = get_listener_data<XDGView*>(listener);
     auto* server = get_server(listener);
 
+    // the client has acked the configure in flight (or a newer one) and committed its answer
+    bool answered = view->configure_serial != 0
+        && static_cast<int32_t>(view->xdg_surface->configure_serial - view->configure_serial) >= 0;
+    if (answered) {
+        view->configure_serial = 0;
+    }
+
     struct wlr_box new_geo;
     wlr_xdg_surface_get_geometry(view->xdg_surface, &new_geo);
     auto& ws = server->output_manager->get_view_workspace(*view);
@@ -234,6 +258,10 @@ void XDGView::surface_commit_handler(struct wl_listener* listener, void*)
 
         ws.arrange_workspace(*(server->output_manager));
     }
+
+    if (answered) {
+        view->size_answered();
+    }
 }
 
 void XDGView::surface_new_popup_handler(struct wl_listener* listener, void* data)
@@ -295,7 +323,18 @@ void XDGPopup::map_handler(struct wl_listener* listener, void*)
     auto* server = get_server(listener);
     auto* popup = get_listener_data<XDGPopup*>(listener);
 
+    server->surface_manager.mapped_view_popups++;
     popup->parent->get_views_output(*server).and_then([popup](const auto& output) {
         wlr_surface_send_enter(popup->wlr_popup->base->surface, output.wlr_output);
     });
 }
+
+void XDGPopup::unmap_handler(struct wl_listener* listener, void*)
+{
+    auto* server = get_server(listener);
+    auto* popup = get_listener_data<XDGPopup*>(listener);
+
+    server->surface_manager.mapped_view_popups--;
+    // the popup is still part of the parent's surface tree at this point
+    output_damage_view(*server, *popup->parent, true);
+}
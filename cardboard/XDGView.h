@@ -10,13 +10,14 @@ public:
     struct wlr_xdg_surface* xdg_surface;
     /// Stores listeners that are active only when the view is mapped. They are removed when unmapping.
     std::array<struct wl_listener*, 4> map_unmap_listeners;
+    /// Serial of the configure carrying View::requested_size, or 0 if the client has answered it.
+    uint32_t configure_serial = 0;
 
     XDGView(struct wlr_xdg_surface* xdg_surface);
     ~XDGView() = default;
 
     struct wlr_surface* get_surface() final;
     bool get_surface_under_coords(double lx, double ly, struct wlr_surface*& surface, double& sx, double& sy) final;
-    void resize(int width, int height) final;
     void prepare(Server& server) final;
     void set_activated(bool activated) final;
     void set_fullscreen(bool fullscreen) final;
@@ -25,6 +26,10 @@ public:
     void close_popups() final;
     void close() final;
 
+protected:
+    bool send_size(int width, int height) final;
+    bool is_size_in_flight() final;
+
 public:
     static void surface_map_handler(struct wl_listener* listener, void* data);
     static void surface_unmap_handler(struct wl_listener* listener, void* data);
@@ -50,6 +55,7 @@ public:
     static void destroy_handler(struct wl_listener* listener, void* data);
     static void new_popup_handler(struct wl_listener* listener, void* data);
     static void map_handler(struct wl_listener* listener, void* data);
+    static void unmap_handler(struct wl_listener* listener, void* data);
 };
 
 #endif // CARDBOARD_XDGVIEW_H_INCLUDED
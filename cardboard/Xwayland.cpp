@@ -2,6 +2,8 @@ extern "C" {
 #include <wlr/util/log.h>
 }
 
+#include <tuple>
+
 #include "Helpers.h"
 #include "Listener.h"
 #include "Server.h"
@@ -18,6 +20,10 @@ XwaylandView::XwaylandView(Server* server, struct wlr_xwayland_surface* xwayland
 
 void XwaylandView::destroy()
 {
+    if (configure_idle != nullptr) {
+        wl_event_source_remove(configure_idle);
+        configure_idle = nullptr;
+    }
     server->listeners.clear_listeners(this);
     if (server->seat.is_grabbing(*this)) {
         server->seat.end_interactive(*server);
@@ -54,22 +60,48 @@ bool XwaylandView::get_surface_under_coords(double lx, double ly, struct wlr_sur
     return false;
 }
 
-void XwaylandView::resize(int width, int height)
+bool XwaylandView::send_size(int width, int height)
 {
     assert(mapped);
 
-    View::resize(width, height);
+    configure_width = width;
+    configure_height = height;
+    return schedule_configure();
+}
 
-    wlr_xwayland_surface_configure(
-        xwayland_surface, x, y, width, height);
+bool XwaylandView::is_size_in_flight()
+{
+    return false;
 }
 
 void XwaylandView::move(int x_, int y_)
 {
     View::move(x_, y_);
 
+    if (configure_idle == nullptr) {
+        // keep the size we asked for, the client may not have committed it yet
+        std::tie(configure_width, configure_height) = requested_size.value_or(std::pair { geometry.width, geometry.height });
+    }
+    schedule_configure();
+}
+
+bool XwaylandView::schedule_configure()
+{
+    if (configure_idle != nullptr) {
+        return true;
+    }
+
+    configure_idle = wl_event_loop_add_idle(server->event_loop, XwaylandView::configure_idle_callback, this);
+    return false;
+}
+
+void XwaylandView::configure_idle_callback(void* data)
+{
+    auto* view = static_cast<XwaylandView*>(data);
+    view->configure_idle = nullptr;
+
     wlr_xwayland_surface_configure(
-        xwayland_surface, x, y, geometry.width, geometry.height);
+        view->xwayland_surface, view->x, view->y, view->configure_width, view->configure_height);
 }
 
 void XwaylandView::prepare(Server& server)
@@ -192,6 +224,8 @@ void XwaylandView::surface_request_configure_handler(struct wl_listener* listene
 
     view->geometry.width = ev->width;
     view->geometry.height = ev->height;
+    // the client waits for an answer, even if it asks for the size it already has
+    view->requested_size = std::nullopt;
     view->resize(view->geometry.width, view->geometry.height);
 }
 
@@ -256,6 +290,7 @@ void XwaylandORSurface::map(Server& server)
 
     lx = xwayland_surface->x;
     ly = xwayland_surface->y;
+    damage_whole(server);
 
     if (wlr_xwayland_or_surface_wants_focus(xwayland_surface)) {
         wlr_xwayland_set_seat(server.xwayland, server.seat.wlr_seat);
@@ -263,6 +298,20 @@ void XwaylandORSurface::map(Server& server)
     }
 }
 
+void XwaylandORSurface::damage_whole(Server& server)
+{
+    for (auto& output : server.output_manager->outputs) {
+        output_damage_box(server,
+                          output,
+                          {
+                              .x = lx,
+                              .y = ly,
+                              .width = xwayland_surface->width,
+                              .height = xwayland_surface->height,
+                          });
+    }
+}
+
 XwaylandORSurface* create_xwayland_or_surface(Server& server, struct wlr_xwayland_surface* xwayland_surface)
 {
     wlr_log(WLR_DEBUG, "new xwayland OR surface %d %d", xwayland_surface->x, xwayland_surface->y);
@@ -290,6 +339,7 @@ void XwaylandORSurface::surface_unmap_handler(struct wl_listener* listener, void
 
     xwayland_or_surface->mapped = false;
     server->listeners.remove_listener(xwayland_or_surface->commit_listener);
+    xwayland_or_surface->damage_whole(*server);
     if (server->seat.wlr_seat->keyboard_state.focused_surface == xwayland_or_surface->xwayland_surface->surface) {
         // restore focus to the last focused view
         if (!server->seat.focus_stack.empty()) {
@@ -318,8 +368,14 @@ void XwaylandORSurface::surface_request_configure_handler(struct wl_listener* li
 
 void XwaylandORSurface::surface_commit_handler(struct wl_listener* listener, void*)
 {
+    auto* server = get_server(listener);
     auto* xwayland_or_surface = get_listener_data<XwaylandORSurface*>(listener);
 
-    xwayland_or_surface->lx = xwayland_or_surface->xwayland_surface->x;
-    xwayland_or_surface->ly = xwayland_or_surface->xwayland_surface->y;
+    auto* xsurface = xwayland_or_surface->xwayland_surface;
+    if (xsurface->x != xwayland_or_surface->lx || xsurface->y != xwayland_or_surface->ly) {
+        xwayland_or_surface->damage_whole(*server);
+        xwayland_or_surface->lx = xsurface->x;
+        xwayland_or_surface->ly = xsurface->y;
+        xwayland_or_surface->damage_whole(*server);
+    }
 }
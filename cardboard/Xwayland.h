@@ -18,13 +18,16 @@ public:
     struct wlr_xwayland_surface* xwayland_surface;
     /// Stores listeners that are active only when the view is mapped. They are removed when unmapping.
     std::array<struct wl_listener*, 2> map_unmap_listeners;
+    /// Sends the pending configure, so that all the moves and resizes of an event loop iteration are sent at once.
+    struct wl_event_source* configure_idle = nullptr;
+    /// The size sent by the pending configure.
+    int configure_width = 0, configure_height = 0;
 
     XwaylandView(Server* server, struct wlr_xwayland_surface* xwayland_surface);
     ~XwaylandView() = default;
 
     struct wlr_surface* get_surface() final;
     bool get_surface_under_coords(double lx, double ly, struct wlr_surface*& surface, double& sx, double& sy) final;
-    void resize(int width, int height) final;
     void move(int x, int y) final;
     void prepare(Server& server) final;
     void set_activated(bool activated) final;
@@ -37,6 +40,16 @@ public:
     void destroy();
     void unmap();
 
+protected:
+    bool send_size(int width, int height) final;
+    /// X11 clients don't acknowledge configures, so sizes are never in flight.
+    bool is_size_in_flight() final;
+
+private:
+    /// Schedules the pending configure. Returns true if it was already scheduled.
+    bool schedule_configure();
+    static void configure_idle_callback(void* data);
+
 public:
     static void surface_map_handler(struct wl_listener* listener, void* data);
     static void surface_unmap_handler(struct wl_listener* listener, void* data);
@@ -58,6 +71,8 @@ struct XwaylandORSurface {
 
     bool get_surface_under_coords(double lx, double ly, struct wlr_surface*& surface, double& sx, double& sy);
     void map(Server& server);
+    /// Damages the area of this surface on all outputs.
+    void damage_whole(Server& server);
 
 public:
     static void surface_map_handler(struct wl_listener* listener, void* data);
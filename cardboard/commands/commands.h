@@ -35,6 +35,7 @@ inline CommandResult config_gap(Server* server, int gap)
 inline CommandResult config_focus_color(Server* server, float r, float g, float b, float a)
 {
     server->config.focus_color = { r, g, b, a };
+    damage_all_outputs(*server);
     return { "" };
 }
 
@@ -105,30 +106,31 @@ inline CommandResult quit(Server* server, int code)
     return { "" };
 }
 
-inline CommandResult bind(Server* server, uint32_t modifiers, xkb_keysym_t sym, const Command& command)
+inline CommandResult bind(Server* server, const std::string& mode, const std::vector<KeyCombo>& keys, const Command& command, bool locked)
 {
-    server->keybindings_config.map[modifiers].insert({ sym, command });
+    if (auto error = server->keybindings_config.bind(mode.empty() ? KeybindingsConfig::DEFAULT_MODE : mode, keys, command, locked); error) {
+        return { *error };
+    }
     return { "" };
 }
 
-inline CommandResult exec(Server*, std::vector<std::string> arguments)
+inline CommandResult mode(Server* server, const std::string& name)
 {
-    spawn([&arguments]() {
-        std::vector<char*> argv;
-        argv.reserve(arguments.size());
-        for (const auto& arg : arguments)
-            strcpy(
-                argv.emplace_back(static_cast<char*>(malloc(arg.size() + 1))),
-                arg.c_str());
-        argv.push_back(nullptr);
-
-        int err_code = execvpe(argv[0], argv.data(), environ);
+    if (!server->keybindings_config.set_mode(name)) {
+        return { "no key bindings in mode " + name };
+    }
+    return { "" };
+}
 
-        for (auto p : argv)
-            free(p);
+inline CommandResult exec(Server* server, const std::vector<std::string>& arguments)
+{
+    if (arguments.empty()) {
+        return { "nothing to execute" };
+    }
 
-        return err_code;
-    });
+    if (auto pid = spawn(*server, arguments); !pid) {
+        return { "Couldn't execute " + arguments[0] + ": " + pid.error().message() };
+    }
 
     return { "" };
 }
@@ -256,9 +258,10 @@ inline CommandResult move(Server* server, int dx, int dy)
         auto current_column = it;
 
         if (dx != 0) {
-            std::advance(other, dx / abs(dx));
+            auto column_index = std::distance(workspace.columns.begin(), it) + dx / std::abs(dx);
 
-            if (other != workspace.columns.end() && other != std::prev(workspace.columns.begin())) {
+            if (column_index >= 0 && column_index < static_cast<decltype(column_index)>(workspace.columns.size())) {
+                other = workspace.columns.begin() + column_index;
                 std::swap(*other, *it);
                 current_column = other;
             }
@@ -282,6 +285,8 @@ inline CommandResult move(Server* server, int dx, int dy)
                 *other_tile);
         }
 
+        workspace.update_tile_index(std::distance(workspace.columns.begin(), std::min(it, current_column)));
+
         workspace.arrange_workspace(*(server->output_manager), true);
         workspace.fit_view_on_screen(*(server->output_manager), *current_column->tiles.begin()->view);
     } else {
@@ -370,6 +375,9 @@ inline CommandResult cycle_width(Server* server)
     return { "" };
 }
 
+/// Answers with the state of the compositor, see libcardboard::query::State. Implemented in query.cpp.
+CommandResult query(Server* server, command_arguments::query::Kind kind, bool json);
+
 };
 
 #endif // CARDBOARD_COMMANDS_COMMANDS_H_INCLUDED
@@ -91,6 +91,17 @@ Command dispatch_command(const CommandData& command_data)
                               return [quit_data](Server* server) { return commands::quit(server, quit_data.code); };
                           },
                           [](const command_arguments::bind& bind_data) -> Command {
+                              std::vector<KeyCombo> keys;
+                              keys.reserve(bind_data.chord.size() + 1);
+
+                              for (const auto& key_combo : bind_data.chord) {
+                                  xkb_keysym_t sym = xkb_keysym_from_name(key_combo.key.c_str(), XKB_KEYSYM_CASE_INSENSITIVE);
+                                  if (sym == XKB_KEY_NoSymbol)
+                                      return { [key = key_combo.key](Server*) -> CommandResult { return { std::string("Invalid keysym: ") + key }; } };
+
+                                  keys.push_back({ modifier_array_to_mask(key_combo.modifiers), sym });
+                              }
+
                               uint32_t modifiers = modifier_array_to_mask(bind_data.modifiers);
 
                               xkb_keysym_t sym = xkb_keysym_from_name(bind_data.key.c_str(), XKB_KEYSYM_CASE_INSENSITIVE);
@@ -98,9 +109,11 @@ Command dispatch_command(const CommandData& command_data)
                               if (sym == XKB_KEY_NoSymbol)
                                   return { [bind_data](Server*) -> CommandResult { return { std::string("Invalid keysym: ") + bind_data.key }; } };
 
+                              keys.push_back({ modifiers, sym });
+
                               Command command = dispatch_command(*(bind_data.command));
-                              return { [modifiers, sym, command](Server* server) {
-                                  return commands::bind(server, modifiers, sym, command);
+                              return { [mode = bind_data.mode, keys = std::move(keys), command, locked = bind_data.locked](Server* server) {
+                                  return commands::bind(server, mode, keys, command, locked);
                               } };
                           },
                           [](const command_arguments::exec exec_data) -> Command {
@@ -139,6 +152,20 @@ Command dispatch_command(const CommandData& command_data)
                           [](const command_arguments::cycle_width&) -> Command {
                               return commands::cycle_width;
                           },
+                          [](const command_arguments::query& query) -> Command {
+                              return [query](Server* server) {
+                                  return commands::query(server, query.kind, query.json);
+                              };
+                          },
+                          [](const command_arguments::subscribe&) -> Command {
+                              // IPC handles subscriptions itself, there is nothing to subscribe from a keybinding
+                              return [](Server*) -> CommandResult { return { "subscribe is only available over IPC" }; };
+                          },
+                          [](const command_arguments::mode& mode) -> Command {
+                              return [name = mode.name](Server* server) {
+                                  return commands::mode(server, name);
+                              };
+                          },
                       },
                       command_data);
 }
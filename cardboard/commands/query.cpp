@@ -0,0 +1,93 @@
+#include <cardboard/query.h>
+
+#include <cstdint>
+
+#include "commands.h"
+
+namespace query = libcardboard::query;
+
+static query::View describe_view(Server& server, View& view)
+{
+    auto& workspace = server.output_manager->get_view_workspace(view);
+
+    return {
+        .id = view.id,
+        .workspace = static_cast<int32_t>(view.workspace_id),
+        .geometry = {
+            .x = view.x + view.geometry.x,
+            .y = view.y + view.geometry.y,
+            .width = view.geometry.width,
+            .height = view.geometry.height,
+        },
+        .floating = workspace.is_view_floating(view),
+        .fullscreen = workspace.fullscreen_view.raw_pointer() == &view,
+    };
+}
+
+static query::Workspace describe_workspace(Server& server, Workspace& workspace, bool with_views)
+{
+    query::Workspace result = {
+        .index = static_cast<int32_t>(workspace.index),
+        .output = workspace.output ? workspace.output.unwrap().wlr_output->name : "",
+        .scroll_x = workspace.scroll_x,
+        .columns = {},
+        .floating_views = {},
+    };
+
+    if (with_views) {
+        result.columns.reserve(workspace.columns.size());
+        for (auto& column : workspace.columns) {
+            auto& tiles = result.columns.emplace_back().tiles;
+            for (auto& tile : column.tiles) {
+                if (tile.view->mapped) {
+                    tiles.push_back(describe_view(server, *tile.view));
+                }
+            }
+        }
+        for (auto& view : workspace.floating_views) {
+            if (view->mapped) {
+                result.floating_views.push_back(describe_view(server, *view));
+            }
+        }
+    }
+
+    return result;
+}
+
+CommandResult commands::query(Server* server, command_arguments::query::Kind kind, bool json)
+{
+    using Kind = command_arguments::query::Kind;
+
+    query::State state;
+
+    if (kind == Kind::Tree || kind == Kind::Outputs) {
+        for (auto& output : server->output_manager->outputs) {
+            const struct wlr_box* box = server->output_manager->get_output_box(output);
+            state.outputs.push_back({
+                .name = output.wlr_output->name,
+                .box = { box->x, box->y, box->width, box->height },
+                .usable_area = { output.usable_area.x, output.usable_area.y, output.usable_area.width, output.usable_area.height },
+            });
+        }
+    }
+
+    if (kind == Kind::Tree || kind == Kind::Workspaces) {
+        for (auto& workspace : server->output_manager->workspaces) {
+            state.workspaces.push_back(describe_workspace(*server, workspace, kind == Kind::Tree));
+        }
+    }
+
+    if (kind != Kind::Outputs) {
+        server->seat.get_focused_workspace(*server).and_then([&state](auto& workspace) {
+            state.focused_workspace = static_cast<int32_t>(workspace.index);
+        });
+    }
+
+    if (kind == Kind::Tree || kind == Kind::Focused) {
+        server->seat.get_focused_view().and_then([server, &state](auto& view) {
+            state.focused_view = describe_view(*server, view);
+        });
+    }
+
+    return { json ? query::state_to_json(state) : query::encode_state(state) };
+}
@@ -3,7 +3,6 @@ extern "C" {
 }
 
 #include <signal.h>
-#include <sys/wait.h>
 
 #include "BuildConfig.h"
 #include "Server.h"
@@ -12,11 +11,7 @@ Server server;
 
 void sig_handler(int signo)
 {
-    if (signo == SIGCHLD) {
-        signal(signo, sig_handler);
-        while (waitpid(-1, 0, WNOHANG) > 0)
-            ;
-    } else if (signo == SIGINT || signo == SIGHUP || signo == SIGTERM) {
+    if (signo == SIGINT || signo == SIGHUP || signo == SIGTERM) {
         server.teardown(0);
     }
 }
@@ -28,7 +23,6 @@ int main()
     signal(SIGINT, sig_handler);
     signal(SIGHUP, sig_handler);
     signal(SIGTERM, sig_handler);
-    signal(SIGCHLD, sig_handler);
     signal(SIGPIPE, SIG_IGN);
 
     if (!server.init()) {
@@ -1,5 +1,10 @@
+#include <cerrno>
 #include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <string_view>
+#include <vector>
 
 #include <cardboard/client.h>
 #include <cardboard/command_protocol.h>
@@ -9,7 +14,111 @@
 
 void print_usage(char* argv0)
 {
-    std::cerr << "Usage: " << argv0 << " <command> [args...]" << std::endl;
+    std::cerr << "Usage: " << argv0 << " <command> [args...]" << std::endl
+              << "       " << argv0 << " --batch [file]" << std::endl;
+}
+
+libcutter::Client open_client_or_exit()
+{
+    return libcutter::open_client()
+        .map_error([](const std::string& error) {
+            std::cerr << "cutter: " << error << std::endl;
+            exit(EXIT_FAILURE);
+        })
+        .value();
+}
+
+/// Reports an error that happened while waiting for a message of the compositor.
+void print_read_error(int error_code)
+{
+    if (error_code == EPROTONOSUPPORT) {
+        std::cerr << "cutter: the compositor speaks another version of the IPC protocol than cutter ("
+                  << libcardboard::ipc::PROTOCOL_VERSION << ")" << std::endl;
+        return;
+    }
+    std::cerr << "cutter: error code " << error_code << std::endl;
+}
+
+/// Prints \a event as a line of space-separated key=value pairs, for scripts to consume.
+void print_event(const libcardboard::ipc::Event& event)
+{
+    using libcardboard::ipc::EventType;
+
+    switch (event.type) {
+    case EventType::ViewFocused:
+        std::cout << "view_focused view=" << event.view << " workspace=" << event.workspace;
+        break;
+    case EventType::WorkspaceFocused:
+        std::cout << "workspace_focused workspace=" << event.workspace << " output=" << event.output;
+        break;
+    case EventType::ViewMapped:
+        std::cout << "view_mapped view=" << event.view << " workspace=" << event.workspace;
+        break;
+    case EventType::ViewUnmapped:
+        std::cout << "view_unmapped view=" << event.view << " workspace=" << event.workspace;
+        break;
+    case EventType::OutputAdded:
+        std::cout << "output_added output=" << event.output << " workspace=" << event.workspace;
+        break;
+    case EventType::OutputRemoved:
+        std::cout << "output_removed output=" << event.output;
+        break;
+    case EventType::EventsDropped:
+        std::cout << "events_dropped count=" << event.dropped;
+        break;
+    }
+    // flush every line, the output is usually piped into a status bar
+    std::cout << std::endl;
+}
+
+/**
+ * \brief Runs every command of \a input, one per line, over a single connection.
+ *
+ * Lines that can't be parsed are reported and skipped, the others are sent together.
+ */
+int run_batch(std::istream& input, std::string_view source_name)
+{
+    std::vector<CommandData> commands;
+    std::vector<int> command_lines;
+    bool failed = false;
+
+    std::string line;
+    for (int line_number = 1; std::getline(input, line); line_number++) {
+        parse_line(line)
+            .map([&commands, &command_lines, line_number](std::optional<CommandData>&& command_data) {
+                if (command_data) {
+                    commands.push_back(std::move(*command_data));
+                    command_lines.push_back(line_number);
+                }
+            })
+            .map_error([&failed, source_name, line_number](const std::string& error) {
+                std::cerr << "cutter: " << source_name << ":" << line_number << ": " << error << std::endl;
+                failed = true;
+            });
+    }
+
+    if (commands.empty()) {
+        return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+    libcutter::Client client = open_client_or_exit();
+    std::vector<std::string> responses = client.send_batch(commands)
+                                             .map_error([](const std::string& error) {
+                                                 std::cerr << "cutter: " << error << std::endl;
+                                                 exit(EXIT_FAILURE);
+                                             })
+                                             .value();
+
+    for (size_t i = 0; i < responses.size(); i++) {
+        if (!responses[i].empty()) {
+            std::cout << source_name << ":" << command_lines[i] << ": " << responses[i];
+            if (responses[i].back() != '\n') {
+                std::cout << std::endl;
+            }
+        }
+    }
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
 }
 
 int main(int argc, char* argv[])
@@ -19,6 +128,24 @@ int main(int argc, char* argv[])
         return EXIT_FAILURE;
     }
 
+    if (std::strcmp(argv[1], "--batch") == 0) {
+        if (argc > 3) {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        if (argc == 2 || std::strcmp(argv[2], "-") == 0) {
+            return run_batch(std::cin, "<stdin>");
+        }
+
+        std::ifstream file(argv[2]);
+        if (!file) {
+            std::cerr << "cutter: couldn't open " << argv[2] << ": " << std::strerror(errno) << std::endl;
+            return EXIT_FAILURE;
+        }
+        return run_batch(file, argv[2]);
+    }
+
     CommandData command_data = parse_arguments(argc, argv)
                                    .map_error([](const std::string& error) {
                                        std::cerr << "cutter: " << error << std::endl;
@@ -26,12 +153,7 @@ int main(int argc, char* argv[])
                                    })
                                    .value();
 
-    libcutter::Client client = libcutter::open_client()
-                                   .map_error([](const std::string& error) {
-                                       std::cerr << "cutter: " << error << std::endl;
-                                       exit(EXIT_FAILURE);
-                                   })
-                                   .value();
+    libcutter::Client client = open_client_or_exit();
 
     client.send_command(command_data)
         .map_error([](const std::string& error) {
@@ -41,12 +163,27 @@ int main(int argc, char* argv[])
 
     std::string response = client.wait_response()
                                .map_error([](int error_code) {
-                                   std::cerr << "cutter: error code " << error_code << std::endl;
+                                   print_read_error(error_code);
                                    exit(EXIT_FAILURE);
                                })
                                .value();
 
     std::cout << response;
 
+    if (std::holds_alternative<command_arguments::subscribe>(command_data)) {
+        while (true) {
+            libcardboard::ipc::Event event = client.wait_event()
+                                                 .map_error([](int error_code) {
+                                                     if (error_code == ECONNRESET) {
+                                                         exit(EXIT_SUCCESS); // the compositor exited
+                                                     }
+                                                     print_read_error(error_code);
+                                                     exit(EXIT_FAILURE);
+                                                 })
+                                                 .value();
+            print_event(event);
+        }
+    }
+
     return 0;
 }
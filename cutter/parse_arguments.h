@@ -110,47 +110,94 @@ tl::expected<CommandData, std::string> parse_exec(const std::vector<std::string>
     return command_arguments::exec { args };
 }
 
-tl::expected<CommandData, std::string> parse_bind(const std::vector<std::string>& args)
+/// Parses a key combination like "super+shift+x", the key being lowercased.
+command_arguments::bind::key_combo parse_key_combo(const std::string& combo)
 {
-    std::vector<std::string> modifiers;
-    std::string key;
+    command_arguments::bind::key_combo key_combo;
 
     auto locale = std::locale("");
 
-    if (args.size() < 2) {
-        return tl::unexpected("not enough arguments"s);
-    }
-
     size_t pos = 0;
-    while (pos < args[0].size()) {
-        auto plus_index = args[0].find('+', pos);
-        auto token = args[0].substr(pos, plus_index - pos);
+    while (pos < combo.size()) {
+        auto plus_index = combo.find('+', pos);
+        auto token = combo.substr(pos, plus_index - pos);
 
         if (find_mod_key(token)) {
-            modifiers.push_back(token);
+            key_combo.modifiers.push_back(token);
         } else {
             for (char& c : token)
                 c = std::tolower(c, locale);
-            key = token;
+            key_combo.key = token;
         }
 
-        if (plus_index == args[0].npos) {
-            pos = args[0].size();
+        if (plus_index == combo.npos) {
+            pos = combo.size();
         } else {
             pos = plus_index + 1;
         }
     }
 
-    auto sub_command_args = std::vector(args.begin() + 1, args.end());
+    return key_combo;
+}
+
+tl::expected<CommandData, std::string> parse_bind(const std::vector<std::string>& args)
+{
+    std::string mode;
+    bool locked = false;
+    size_t keys_index = 0;
+
+    while (keys_index < args.size() && args[keys_index].starts_with("--")) {
+        if (args[keys_index] == "--mode") {
+            if (keys_index + 1 >= args.size()) {
+                return tl::unexpected("not enough arguments"s);
+            }
+            mode = args[keys_index + 1];
+            keys_index += 2;
+        } else if (args[keys_index] == "--locked") {
+            locked = true;
+            keys_index++;
+        } else {
+            return tl::unexpected("unknown option '"s + args[keys_index] + "'");
+        }
+    }
+
+    if (args.size() < keys_index + 2) {
+        return tl::unexpected("not enough arguments"s);
+    }
+
+    // a chord is a comma-separated list of key combinations
+    std::vector<command_arguments::bind::key_combo> chord;
+    const std::string& keys = args[keys_index];
+    size_t pos = 0;
+    while (true) {
+        auto comma_index = keys.find(',', pos);
+        chord.push_back(parse_key_combo(keys.substr(pos, comma_index - pos)));
+        if (chord.back().key.empty()) {
+            return tl::unexpected("missing key in '"s + keys + "'");
+        }
+
+        if (comma_index == keys.npos) {
+            break;
+        }
+        pos = comma_index + 1;
+    }
+
+    auto last = std::move(chord.back());
+    chord.pop_back();
+
+    auto sub_command_args = std::vector(args.begin() + keys_index + 1, args.end());
     auto command_data = parse_arguments(sub_command_args);
 
     if (!command_data.has_value())
         return tl::unexpected("could not parse sub command: \n"s + command_data.error());
 
     return command_arguments::bind {
-        std::move(modifiers),
-        std::move(key),
-        std::move(*command_data)
+        std::move(last.modifiers),
+        std::move(last.key),
+        std::move(*command_data),
+        std::move(chord),
+        std::move(mode),
+        locked
     };
 }
 
@@ -245,6 +292,31 @@ tl::expected<CommandData, std::string> parse_cycle_width(const std::vector<std::
     return command_arguments::cycle_width {};
 }
 
+tl::expected<CommandData, std::string> parse_subscribe(const std::vector<std::string>&)
+{
+    return command_arguments::subscribe {};
+}
+
+tl::expected<CommandData, std::string> parse_mode(const std::vector<std::string>& args)
+{
+    if (args.size() != 1) {
+        return tl::unexpected("expected the name of a mode"s);
+    }
+
+    return command_arguments::mode { args[0] };
+}
+
+/// cutter prints the answers of queries, so it always asks for JSON.
+template <command_arguments::query::Kind kind>
+tl::expected<CommandData, std::string> parse_query(const std::vector<std::string>& args)
+{
+    if (!args.empty()) {
+        return tl::unexpected("too many arguments"s);
+    }
+
+    return command_arguments::query { kind, true };
+}
+
 using parse_f = tl::expected<CommandData, std::string> (*)(const std::vector<std::string>&);
 static std::unordered_map<std::string, parse_f> parse_table = {
     { "quit", parse_quit },
@@ -260,6 +332,12 @@ static std::unordered_map<std::string, parse_f> parse_table = {
     { "pop_from_column", parse_pop_from_column },
     { "config", parse_config },
     { "cycle_width", parse_cycle_width },
+    { "subscribe", parse_subscribe },
+    { "get_tree", parse_query<command_arguments::query::Kind::Tree> },
+    { "get_workspaces", parse_query<command_arguments::query::Kind::Workspaces> },
+    { "get_outputs", parse_query<command_arguments::query::Kind::Outputs> },
+    { "get_focused", parse_query<command_arguments::query::Kind::Focused> },
+    { "mode", parse_mode },
 };
 
 tl::expected<CommandData, std::string> parse_arguments(std::vector<std::string> arguments)
@@ -289,4 +367,89 @@ tl::expected<CommandData, std::string> parse_arguments(int argc, char* argv[])
     return detail::parse_arguments(std::move(arguments));
 }
 
+/**
+ * \brief Splits a line of a batch file into arguments, like a shell would
+ *
+ * Arguments are separated by blanks, single quotes keep everything literally,
+ * double quotes and backslashes escape blanks and quotes. A '#' starting an argument
+ * comments out the rest of the line.
+ */
+tl::expected<std::vector<std::string>, std::string> split_line(const std::string& line)
+{
+    using namespace std::string_literals;
+
+    std::vector<std::string> arguments;
+    std::string current;
+    bool in_argument = false;
+    char quote = '\0';
+
+    for (size_t i = 0; i < line.size(); i++) {
+        char c = line[i];
+
+        if (quote == '\'') {
+            if (c == '\'') {
+                quote = '\0';
+            } else {
+                current += c;
+            }
+        } else if (c == '\\' && i + 1 < line.size() && (quote == '\0' || line[i + 1] == '"' || line[i + 1] == '\\')) {
+            current += line[++i];
+            in_argument = true;
+        } else if (quote == '"') {
+            if (c == '"') {
+                quote = '\0';
+            } else {
+                current += c;
+            }
+        } else if (c == '\'' || c == '"') {
+            quote = c;
+            in_argument = true;
+        } else if (c == ' ' || c == '\t' || c == '\r') {
+            if (in_argument) {
+                arguments.push_back(std::move(current));
+                current.clear();
+                in_argument = false;
+            }
+        } else if (c == '#' && !in_argument) {
+            break;
+        } else {
+            current += c;
+            in_argument = true;
+        }
+    }
+
+    if (quote != '\0') {
+        return tl::unexpected("unterminated quote"s);
+    }
+    if (in_argument) {
+        arguments.push_back(std::move(current));
+    }
+
+    return arguments;
+}
+
+/**
+ * \brief Parses a line of a batch file
+ * \return std::nullopt for blank lines and comments
+ */
+tl::expected<std::optional<CommandData>, std::string> parse_line(const std::string& line)
+{
+    auto arguments = split_line(line);
+    if (!arguments) {
+        return tl::unexpected(arguments.error());
+    }
+    if (arguments->empty()) {
+        return std::nullopt;
+    }
+
+    try {
+        return detail::parse_arguments(std::move(*arguments)).map([](CommandData&& command_data) {
+            return std::optional<CommandData> { std::move(command_data) };
+        });
+    } catch (const std::exception& e) {
+        // std::stoi and friends throw on malformed numbers
+        return tl::unexpected(std::string { "malformed argument: " } + e.what());
+    }
+}
+
 #endif //CUTTER_PARSE_ARGUMENTS_H_INCLUDED
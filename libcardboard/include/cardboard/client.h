@@ -1,12 +1,16 @@
 #ifndef LIBCARDBOARD_CLIENT_H_INCLUDED
 #define LIBCARDBOARD_CLIENT_H_INCLUDED
 
+#include <cstdint>
+#include <deque>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <tl/expected.hpp>
 
 #include "command_protocol.h"
+#include "ipc.h"
 
 #include <sys/un.h>
 
@@ -24,19 +28,58 @@ public:
 
     /**
      * \brief Serializes and sends a CommandData packet to the server
+     *
+     * The connection stays open, so more commands can be sent before waiting for the responses.
+     *
+     * \return the request ID the response will carry
      */
-    tl::expected<void, std::string> send_command(const CommandData&);
+    tl::expected<uint32_t, std::string> send_command(const CommandData&);
 
     /**
-     * \brief Waits for a string response from the server
+     * \brief Waits for the response to the oldest command that wasn't answered yet
      */
     tl::expected<std::string, int> wait_response();
 
+    /**
+     * \brief Waits for the next event, after a \c subscribe command was sent
+     *
+     * Responses to commands that are still pending are discarded.
+     */
+    tl::expected<libcardboard::ipc::Event, int> wait_event();
+
+    /**
+     * \brief Sends all the commands in one write and waits for all their responses
+     *
+     * \return the responses, in the order of \a commands
+     */
+    tl::expected<std::vector<std::string>, std::string> send_batch(const std::vector<CommandData>& commands);
+
 private:
     Client(int, std::unique_ptr<sockaddr_un>);
 
+    /// Appends the framed \a command_data to \a buffer, returning its request ID.
+    tl::expected<uint32_t, std::string> frame_command(const CommandData& command_data, std::string& buffer);
+
+    /// Writes the whole \a buffer, retrying on partial writes.
+    tl::expected<void, std::string> write_all(const std::string& buffer);
+
+    /**
+     * Reads a whole message into \a payload, returning its request ID.
+     *
+     * Fails with EPROTONOSUPPORT if the server speaks another version of the IPC protocol.
+     */
+    tl::expected<uint32_t, int> read_message(std::string& payload);
+
+    /// Reads exactly \a size bytes, returning the errno on failure or ECONNRESET if the server hung up.
+    tl::expected<void, int> read_all(void* data, size_t size);
+
     int socket_fd;
     std::unique_ptr<sockaddr_un> socket_address;
+    uint32_t next_request_id = 1;
+    /// Request IDs of the commands that were sent but not answered yet, oldest first.
+    std::deque<uint32_t> pending_requests;
+    /// Events received while waiting for a response.
+    std::deque<libcardboard::ipc::Event> pending_events;
 
     friend tl::expected<Client, std::string> open_client();
 };
@@ -1,8 +1,11 @@
 #ifndef LIBCARDBOARD_COMMAND_PROTOCOL_H_INCLUDED
 #define LIBCARDBOARD_COMMAND_PROTOCOL_H_INCLUDED
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <optional>
+#include <span>
 #include <string>
 #include <variant>
 #include <vector>
@@ -82,6 +85,28 @@ struct config {
 
 struct cycle_width {
 };
+
+/// Keeps the connection open and pushes events (libcardboard::ipc::Event) to it
+struct subscribe {
+};
+
+/// Switches the keybindings to another mode
+struct mode {
+    std::string name;
+};
+
+/// Reads the state of the compositor, answered with a libcardboard::query::State
+struct query {
+    enum class Kind : uint8_t {
+        Tree, ///< outputs, workspaces with their columns and floating views, and the focus
+        Workspaces, ///< workspaces without their views, and the focused workspace
+        Outputs,
+        Focused, ///< the focused workspace and view
+    } kind;
+
+    /// Answer with JSON text instead of the binary encoding.
+    bool json;
+};
 }
 
 /**
@@ -100,20 +125,39 @@ using CommandData = std::variant<
     command_arguments::insert_into_column,
     command_arguments::pop_from_column,
     command_arguments::config,
-    command_arguments::cycle_width>;
+    command_arguments::cycle_width,
+    command_arguments::subscribe,
+    command_arguments::query,
+    command_arguments::mode>;
 
 namespace command_arguments {
 struct bind {
+    /// A key pressed together with modifiers
+    struct key_combo {
+        std::vector<std::string> modifiers;
+        std::string key;
+    };
+
     std::vector<std::string> modifiers;
     std::string key;
     std::unique_ptr<CommandData> command;
 
+    /// Key combinations to press, one after another, before \a modifiers and \a key. Empty for a single key binding.
+    std::vector<key_combo> chord;
+    /// The keybinding mode to bind in, the default mode if empty
+    std::string mode;
+    /// Run the command even when a client, like a lock screen, holds the input exclusively
+    bool locked = false;
+
     bind() = default;
 
-    bind(std::vector<std::string> modifiers, std::string key, CommandData command)
+    bind(std::vector<std::string> modifiers, std::string key, CommandData command, std::vector<key_combo> chord = {}, std::string mode = {}, bool locked = false)
         : modifiers { std::move(modifiers) }
         , key { std::move(key) }
         , command { std::make_unique<CommandData>(std::move(command)) }
+        , chord { std::move(chord) }
+        , mode { std::move(mode) }
+        , locked { locked }
     {
     }
 
@@ -121,6 +165,9 @@ struct bind {
         : modifiers { other.modifiers }
         , key { other.key }
         , command { std::make_unique<CommandData>(*other.command) }
+        , chord { other.chord }
+        , mode { other.mode }
+        , locked { other.locked }
     {
     }
 
@@ -135,6 +182,9 @@ struct bind {
         modifiers = other.modifiers;
         key = other.key;
         command = std::make_unique<CommandData>(*other.command);
+        chord = other.chord;
+        mode = other.mode;
+        locked = other.locked;
 
         return *this;
     }
@@ -142,12 +192,42 @@ struct bind {
 }
 
 /**
- * \brief Deserializes data from a region of memory
+ * \brief First byte of a CommandData encoded with the binary wire format
+ */
+constexpr std::byte COMMAND_WIRE_MAGIC { 0xcb };
+
+/**
+ * \brief Version of the binary wire format, the only one that decode_command accepts
+ */
+constexpr uint8_t COMMAND_WIRE_VERSION = 1;
+
+/**
+ * \brief Returns the number of bytes encode_command writes for \a command_data
+ */
+size_t encoded_command_size(const CommandData& command_data);
+
+/**
+ * \brief Encodes \a command_data with the binary wire format into \a buffer
+ *
+ * The encoding is a magic byte, the version, the index of the command in CommandData and its arguments.
+ * Integers are little endian, strings and vectors are prefixed by their 32-bit length.
+ *
+ * \return the number of bytes written, or 0 if \a buffer is smaller than encoded_command_size()
+ */
+size_t encode_command(const CommandData& command_data, std::span<std::byte> buffer);
+
+/**
+ * \brief Decodes a CommandData encoded with encode_command
+ */
+tl::expected<CommandData, std::string> decode_command(std::span<const std::byte> buffer);
+
+/**
+ * \brief Deserializes data from a region of memory, without copying it
  */
 tl::expected<CommandData, std::string> read_command_data(void* data, size_t);
 
 /**
- * \brief Serializes CommandData type data into a std::string buffer
+ * \brief Serializes CommandData type data into a std::string buffer, with the binary wire format
  */
 tl::expected<std::string, std::string> write_command_data(const CommandData&);
 
@@ -4,21 +4,103 @@
 #include <array>
 #include <cstddef>
 #include <cstdint>
+#include <optional>
+#include <string>
 
 /// Utility code for connecting to cardboard's socket and reading and writing the IPC header.
 namespace libcardboard::ipc {
 
+/**
+ * \brief The version of the IPC protocol
+ *
+ * Version 1 was the header made only of the payload size, with one command per connection.
+ * Peers that speak another version are disconnected.
+ */
+constexpr uint16_t PROTOCOL_VERSION = 2;
+
+/**
+ * \brief The first two bytes of every header, "CB"
+ *
+ * Headers of version 1 don't start with it, which tells such peers apart.
+ */
+constexpr uint16_t HEADER_MAGIC = 0x4243;
+
 /**
  * \brief The IPC header that describes the payload
+ *
+ * A connection carries any number of framed messages, each one made of a header and its payload.
+ * The server answers every command with exactly one response, in the order the commands were received,
+ * and tags the response with the \c request_id of the command.
+ *
+ * On the wire, the header is #HEADER_MAGIC, \c version, \c incoming_bytes and \c request_id, in little endian.
  */
 struct Header {
     int incoming_bytes;
+    /// Chosen by the client to match responses with commands.
+    uint32_t request_id = 0;
+    uint16_t version = PROTOCOL_VERSION;
 };
 
 /**
  * \brief The size of the IPC header in bytes
  */
-constexpr std::size_t HEADER_SIZE = 4;
+constexpr std::size_t HEADER_SIZE = 12;
+
+/**
+ * \brief The largest payload the server accepts, in bytes
+ */
+constexpr int MAX_PAYLOAD_SIZE = 1 << 20;
+
+/**
+ * \brief The request ID of the messages the server pushes to subscribed clients
+ *
+ * Clients never use it for commands, so events can't be confused with responses.
+ */
+constexpr uint32_t EVENT_REQUEST_ID = 0;
+
+/**
+ * \brief Kinds of events sent to the clients that ran the \c subscribe command
+ */
+enum class EventType : uint8_t {
+    ViewFocused, ///< \c view got the keyboard focus, or no view has it if \c view is 0
+    WorkspaceFocused, ///< \c workspace was switched to, on \c output
+    ViewMapped,
+    ViewUnmapped,
+    OutputAdded,
+    OutputRemoved,
+    /// The client didn't read fast enough, \c dropped events were discarded since the last one it received
+    EventsDropped,
+};
+
+/**
+ * \brief An event pushed to subscribed clients
+ *
+ * Fields that don't apply to the type of the event are left to their default value.
+ */
+struct Event {
+    EventType type;
+    int32_t workspace = -1;
+    /// Identifies a view, ids aren't reused once the view is gone
+    uint64_t view = 0;
+    uint32_t dropped = 0;
+    std::string output {};
+};
+
+/**
+ * \brief The size of the fixed part of a serialized Event, before the output name
+ */
+constexpr std::size_t EVENT_FIXED_SIZE = 17;
+
+/**
+ * \brief Serializes \a event as the payload of a message, appending it to \a buffer
+ */
+void write_event(const Event& event, std::string& buffer);
+
+/**
+ * \brief Deserializes the payload of an event message
+ * \return std::nullopt if the payload is malformed
+ */
+std::optional<Event> read_event(const std::byte* data, std::size_t size);
 
 /**
  * \brief Buffer type where the IPC header can be stored for fast serialization and deserialization
@@ -28,8 +110,9 @@ struct alignas(alignof(Header)) AlignedHeaderBuffer : std::array<std::byte, HEAD
 
 /**
  * \brief Deserializes the data in the buffer into a Header value
+ * \return std::nullopt if the buffer doesn't start with #HEADER_MAGIC
  */
-Header interpret_header(const AlignedHeaderBuffer&);
+std::optional<Header> interpret_header(const AlignedHeaderBuffer&);
 
 /**
  * \brief Serializes the Header value into the returned buffer
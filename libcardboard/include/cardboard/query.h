@@ -0,0 +1,88 @@
+#ifndef LIBCARDBOARD_QUERY_H_INCLUDED
+#define LIBCARDBOARD_QUERY_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <tl/expected.hpp>
+
+/// State of the compositor as answered to the query command.
+namespace libcardboard::query {
+
+/**
+ * \brief A rectangle in output layout coordinates
+ */
+struct Box {
+    int32_t x = 0, y = 0;
+    int32_t width = 0, height = 0;
+};
+
+struct View {
+    /// Same identifier as in libcardboard::ipc::Event
+    uint64_t id = 0;
+    int32_t workspace = -1;
+    /// Position and size of the usable area of the view
+    Box geometry;
+    bool floating = false;
+    bool fullscreen = false;
+};
+
+struct Column {
+    std::vector<View> tiles;
+};
+
+struct Workspace {
+    int32_t index = -1;
+    /// Name of the output the workspace is shown on, empty if it is hidden
+    std::string output;
+    int32_t scroll_x = 0;
+    /// Only filled for Kind::Tree
+    std::vector<Column> columns;
+    /// Only filled for Kind::Tree
+    std::vector<View> floating_views;
+};
+
+struct Output {
+    std::string name;
+    Box box;
+    /// Area left to views by layer surfaces such as panels, relative to #box
+    Box usable_area;
+};
+
+/**
+ * \brief Answer to the query command. The parts that weren't asked for are left empty.
+ */
+struct State {
+    std::vector<Output> outputs;
+    std::vector<Workspace> workspaces;
+    int32_t focused_workspace = -1;
+    std::optional<View> focused_view;
+};
+
+/**
+ * \brief Version of the binary encoding of State, independent of COMMAND_WIRE_VERSION
+ */
+constexpr uint8_t STATE_WIRE_VERSION = 1;
+
+/**
+ * \brief Serializes \a state with the binary wire format, see encode_command
+ */
+std::string encode_state(const State& state);
+
+/**
+ * \brief Deserializes a State encoded with encode_state
+ */
+tl::expected<State, std::string> decode_state(std::span<const std::byte> buffer);
+
+/**
+ * \brief Formats \a state as JSON
+ */
+std::string state_to_json(const State& state);
+
+}
+
+#endif // LIBCARDBOARD_QUERY_H_INCLUDED
@@ -5,6 +5,9 @@
 #include <sys/un.h>
 #include <unistd.h>
 
+#include <cerrno>
+#include <cstring>
+
 namespace libcutter {
 
 libcutter::Client::~Client()
@@ -12,60 +15,212 @@ libcutter::Client::~Client()
     close(socket_fd);
 }
 
-tl::expected<void, std::string> libcutter::Client::send_command(const CommandData& command_data)
+tl::expected<uint32_t, std::string> libcutter::Client::frame_command(const CommandData& command_data, std::string& buffer)
+{
+    const size_t payload_size = encoded_command_size(command_data);
+
+    const uint32_t request_id = next_request_id++;
+    if (next_request_id == libcardboard::ipc::EVENT_REQUEST_ID) {
+        // wrapped around, responses must never look like events
+        next_request_id++;
+    }
+    libcardboard::ipc::AlignedHeaderBuffer header_buffer = libcardboard::ipc::create_header_buffer({
+        .incoming_bytes = static_cast<int>(payload_size),
+        .request_id = request_id,
+    });
+
+    buffer.append(reinterpret_cast<const char*>(header_buffer.data()), header_buffer.size());
+
+    // encode in place, after the header
+    const size_t payload_offset = buffer.size();
+    buffer.resize(payload_offset + payload_size);
+    encode_command(command_data, std::as_writable_bytes(std::span { buffer }).subspan(payload_offset));
+
+    return request_id;
+}
+
+tl::expected<void, std::string> libcutter::Client::write_all(const std::string& buffer)
 {
     using namespace std::string_literals;
 
-    auto buffer = write_command_data(command_data);
+    for (size_t written = 0; written < buffer.size();) {
+        ssize_t result = write(socket_fd, buffer.data() + written, buffer.size() - written);
+        if (result == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
 
-    if (!buffer) {
-        return tl::unexpected(buffer.error());
+            int err = errno;
+            return tl::unexpected("unable to write payload: "s + strerror(err));
+        }
+        written += result;
     }
 
-    libcardboard::ipc::AlignedHeaderBuffer header_buffer = libcardboard::ipc::create_header_buffer({ static_cast<int>(buffer->size() + 1) });
+    return {};
+}
 
-    if (write(socket_fd, header_buffer.data(), libcardboard::ipc::HEADER_SIZE) == -1) {
-        int err = errno;
-        return tl::unexpected("unable to write payload: "s + strerror(err));
-    }
+tl::expected<void, int> libcutter::Client::read_all(void* data, size_t size)
+{
+    for (size_t received = 0; received < size;) {
+        ssize_t result = recv(socket_fd, static_cast<char*>(data) + received, size - received, 0);
+        if (result == 0) {
+            return tl::unexpected(ECONNRESET);
+        }
+        if (result == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
 
-    if (write(socket_fd, buffer->c_str(), buffer->size() + 1) == -1) {
-        int err = errno;
-        return tl::unexpected("unable to write payload: "s + strerror(err));
+            int err = errno;
+            return tl::unexpected(err);
+        }
+        received += result;
     }
 
     return {};
 }
 
-tl::expected<std::string, int> libcutter::Client::wait_response()
+tl::expected<uint32_t, std::string> libcutter::Client::send_command(const CommandData& command_data)
+{
+    std::string buffer;
+
+    return frame_command(command_data, buffer)
+        .and_then([this, &buffer](uint32_t request_id) {
+            return write_all(buffer).map([this, request_id]() {
+                pending_requests.push_back(request_id);
+                return request_id;
+            });
+        });
+}
+
+tl::expected<uint32_t, int> libcutter::Client::read_message(std::string& payload)
 {
     libcardboard::ipc::AlignedHeaderBuffer buffer;
 
-    if (recv(socket_fd, buffer.data(), libcardboard::ipc::HEADER_SIZE, 0) == libcardboard::ipc::HEADER_SIZE) {
-        libcardboard::ipc::Header header = libcardboard::ipc::interpret_header(buffer);
+    if (auto result = read_all(buffer.data(), libcardboard::ipc::HEADER_SIZE); !result) {
+        return tl::unexpected(result.error());
+    }
+    auto maybe_header = libcardboard::ipc::interpret_header(buffer);
+    if (!maybe_header) {
+        return tl::unexpected(EPROTO);
+    }
+    libcardboard::ipc::Header header = *maybe_header;
+
+    if (header.version != libcardboard::ipc::PROTOCOL_VERSION) {
+        return tl::unexpected(EPROTONOSUPPORT);
+    }
+    if (header.incoming_bytes < 0) {
+        return tl::unexpected(EPROTO);
+    }
+
+    payload.assign(header.incoming_bytes, '\0');
+    if (auto result = read_all(payload.data(), payload.size()); !result) {
+        return tl::unexpected(result.error());
+    }
+
+    return header.request_id;
+}
+
+tl::expected<std::string, int> libcutter::Client::wait_response()
+{
+    std::string payload;
 
-        if (header.incoming_bytes == 0) {
-            return std::string {};
+    while (true) {
+        auto request_id = read_message(payload);
+        if (!request_id) {
+            return tl::unexpected(request_id.error());
         }
 
-        auto* response_buffer = new std::byte[header.incoming_bytes];
-        if (recv(socket_fd, response_buffer, sizeof(header.incoming_bytes), 0) == header.incoming_bytes) {
-            return std::string(reinterpret_cast<char*>(response_buffer));
-        } else {
-            int err = errno;
-            return tl::unexpected(err);
+        if (*request_id == libcardboard::ipc::EVENT_REQUEST_ID) {
+            // keep events for wait_event
+            auto event = libcardboard::ipc::read_event(reinterpret_cast<const std::byte*>(payload.data()), payload.size());
+            if (!event) {
+                return tl::unexpected(EPROTO);
+            }
+            pending_events.push_back(std::move(*event));
+            continue;
         }
-    } else {
-        int err = errno;
 
-        if (err == EBADF) {
-            return std::string {};
+        // responses come in the order of the commands
+        if (pending_requests.empty() || pending_requests.front() != *request_id) {
+            return tl::unexpected(EPROTO);
         }
+        pending_requests.pop_front();
 
-        return tl::unexpected(err);
+        return payload;
     }
 }
 
+tl::expected<libcardboard::ipc::Event, int> libcutter::Client::wait_event()
+{
+    if (!pending_events.empty()) {
+        libcardboard::ipc::Event event = std::move(pending_events.front());
+        pending_events.pop_front();
+        return event;
+    }
+
+    std::string payload;
+    while (true) {
+        auto request_id = read_message(payload);
+        if (!request_id) {
+            return tl::unexpected(request_id.error());
+        }
+
+        if (*request_id != libcardboard::ipc::EVENT_REQUEST_ID) {
+            // a response nobody waits for anymore
+            if (!pending_requests.empty() && pending_requests.front() == *request_id) {
+                pending_requests.pop_front();
+                continue;
+            }
+            return tl::unexpected(EPROTO);
+        }
+
+        auto event = libcardboard::ipc::read_event(reinterpret_cast<const std::byte*>(payload.data()), payload.size());
+        if (!event) {
+            return tl::unexpected(EPROTO);
+        }
+        return std::move(*event);
+    }
+}
+
+tl::expected<std::vector<std::string>, std::string> libcutter::Client::send_batch(const std::vector<CommandData>& commands)
+{
+    using namespace std::string_literals;
+
+    std::string buffer;
+    std::vector<uint32_t> request_ids;
+    request_ids.reserve(commands.size());
+
+    for (const auto& command_data : commands) {
+        auto request_id = frame_command(command_data, buffer);
+        if (!request_id) {
+            return tl::unexpected(request_id.error());
+        }
+        request_ids.push_back(*request_id);
+    }
+
+    // the server buffers its responses, so it keeps reading while we write the whole batch
+    if (auto result = write_all(buffer); !result) {
+        return tl::unexpected(result.error());
+    }
+    pending_requests.insert(pending_requests.end(), request_ids.begin(), request_ids.end());
+
+    std::vector<std::string> responses;
+    responses.reserve(commands.size());
+    for (size_t i = 0; i < commands.size(); i++) {
+        auto response = wait_response();
+        if (!response && response.error() == EPROTONOSUPPORT) {
+            return tl::unexpected("the compositor speaks another version of the IPC protocol"s);
+        }
+        if (!response) {
+            return tl::unexpected("unable to read response: "s + strerror(response.error()));
+        }
+        responses.push_back(std::move(*response));
+    }
+
+    return responses;
+}
+
 Client::Client(int socket_fd, std::unique_ptr<sockaddr_un> socket_address)
     : socket_fd { socket_fd }
     , socket_address { std::move(socket_address) }
@@ -75,6 +230,9 @@ Client::Client(int socket_fd, std::unique_ptr<sockaddr_un> socket_address)
 Client::Client(Client&& other) noexcept
     : socket_fd { other.socket_fd }
     , socket_address { std::move(other.socket_address) }
+    , next_request_id { other.next_request_id }
+    , pending_requests { std::move(other.pending_requests) }
+    , pending_events { std::move(other.pending_events) }
 {
     other.socket_fd = -1;
 }
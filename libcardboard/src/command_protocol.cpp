@@ -1,151 +1,297 @@
 #include <unistd.h>
 
-#include <cereal/archives/portable_binary.hpp>
-#include <cereal/types/memory.hpp>
-#include <cereal/types/string.hpp>
-#include <cereal/types/variant.hpp>
-#include <cereal/types/vector.hpp>
-
+#include <cstring>
 #include <numeric>
-#include <sstream>
 
 #include <cardboard/command_protocol.h>
 #include <cardboard/ipc.h>
 
+#include "wire.h"
+
+tl::expected<CommandData, std::string> read_command_data(void* data, size_t size)
+{
+    return decode_command({ static_cast<const std::byte*>(data), size });
+}
+
 /// \cond IGNORE
-namespace cereal {
+namespace {
+
+using libcardboard::wire::Decoder;
+using libcardboard::wire::Encoder;
+
+void encode(Encoder& encoder, const CommandData& command_data);
+CommandData decode(Decoder& decoder);
 
-template <typename Archive>
-void serialize(Archive& ar, command_arguments::quit& quit)
+void encode(Encoder& encoder, const command_arguments::quit& quit)
 {
-    ar(quit.code);
+    encoder.i32(quit.code);
 }
 
-template <typename Archive>
-void serialize(Archive& ar, command_arguments::focus& focus)
+void decode(Decoder& decoder, command_arguments::quit& quit)
 {
-    ar(focus.direction, focus.cycle);
+    quit.code = decoder.i32();
 }
 
-template <typename Archive>
-void serialize(Archive& ar, command_arguments::exec& exec)
+void encode(Encoder& encoder, const command_arguments::focus& focus)
 {
-    ar(exec.argv);
+    encoder.u8(static_cast<uint8_t>(focus.direction));
+    encoder.u8(focus.cycle);
 }
 
-template <typename Archive>
-void serialize(Archive& ar, command_arguments::bind& bind)
+void decode(Decoder& decoder, command_arguments::focus& focus)
 {
-    ar(bind.modifiers, bind.key, bind.command);
+    uint8_t direction = decoder.u8();
+    if (direction > static_cast<uint8_t>(command_arguments::focus::Direction::Down)) {
+        decoder.fail("invalid focus direction");
+    }
+    focus.direction = static_cast<command_arguments::focus::Direction>(direction);
+    focus.cycle = decoder.u8() != 0;
 }
 
-template <typename Archive>
-void serialize(Archive&, command_arguments::close&)
+void encode(Encoder& encoder, const command_arguments::exec& exec)
 {
+    encoder.strings(exec.argv);
 }
 
-template <typename Archive>
-void serialize(Archive& ar, command_arguments::workspace::switch_& switch_)
+void decode(Decoder& decoder, command_arguments::exec& exec)
 {
-    ar(switch_.n);
+    exec.argv = decoder.strings();
 }
 
-template <typename Archive>
-void serialize(Archive& ar, command_arguments::workspace::move& move)
+void encode(Encoder& encoder, const command_arguments::bind& bind)
 {
-    ar(move.n);
+    encoder.strings(bind.modifiers);
+    encoder.string(bind.key);
+    encoder.u32(static_cast<uint32_t>(bind.chord.size()));
+    for (const auto& key_combo : bind.chord) {
+        encoder.strings(key_combo.modifiers);
+        encoder.string(key_combo.key);
+    }
+    encoder.string(bind.mode);
+    encoder.u8(bind.locked);
+    encode(encoder, *bind.command);
 }
 
-template <typename Archive>
-void serialize(Archive& ar, command_arguments::workspace& workspace)
+void decode(Decoder& decoder, command_arguments::bind& bind)
 {
-    ar(workspace.workspace);
+    bind.modifiers = decoder.strings();
+    bind.key = decoder.string();
+
+    uint32_t chord_size = decoder.u32();
+    // every key combination takes at least two length prefixes
+    if (decoder.can_read(static_cast<size_t>(chord_size) * 8)) {
+        bind.chord.reserve(chord_size);
+        for (uint32_t i = 0; i < chord_size && !decoder.error; i++) {
+            auto modifiers = decoder.strings();
+            bind.chord.push_back({ std::move(modifiers), decoder.string() });
+        }
+    }
+    bind.mode = decoder.string();
+    bind.locked = decoder.u8() != 0;
+
+    if (++decoder.depth > Decoder::MAX_DEPTH) {
+        decoder.fail("bind commands are nested too deeply");
+    }
+    bind.command = std::make_unique<CommandData>(decode(decoder));
+    decoder.depth--;
 }
 
-template <typename Archive>
-void serialize(Archive&, command_arguments::toggle_floating&)
+void encode(Encoder& encoder, const command_arguments::workspace& workspace)
 {
+    encoder.u8(static_cast<uint8_t>(workspace.workspace.index()));
+    std::visit([&encoder](const auto& value) { encoder.i32(value.n); }, workspace.workspace);
 }
 
-template <typename Archive>
-void serialize(Archive& ar, command_arguments::move& move)
+void decode(Decoder& decoder, command_arguments::workspace& workspace)
 {
-    ar(move.dx, move.dy);
+    uint8_t kind = decoder.u8();
+    int32_t n = decoder.i32();
+
+    if (kind == 0) {
+        workspace.workspace = command_arguments::workspace::switch_ { n };
+    } else if (kind == 1) {
+        workspace.workspace = command_arguments::workspace::move { n };
+    } else {
+        decoder.fail("invalid workspace command");
+    }
 }
 
-template <typename Archive>
-void serialize(Archive& ar, command_arguments::resize& resize)
+void encode(Encoder& encoder, const command_arguments::move& move)
 {
-    ar(resize.width, resize.height);
+    encoder.i32(move.dx);
+    encoder.i32(move.dy);
 }
 
-template <typename Archive>
-void serialize(Archive&, command_arguments::insert_into_column&)
+void decode(Decoder& decoder, command_arguments::move& move)
 {
+    move.dx = decoder.i32();
+    move.dy = decoder.i32();
 }
 
-template <typename Archive>
-void serialize(Archive&, command_arguments::pop_from_column&)
+void encode(Encoder& encoder, const command_arguments::resize& resize)
 {
+    encoder.i32(resize.width);
+    encoder.i32(resize.height);
 }
 
-template <typename Archive>
-void serialize(Archive& ar, command_arguments::config::mouse_mod& mouse_mod)
+void decode(Decoder& decoder, command_arguments::resize& resize)
 {
-    ar(mouse_mod.modifiers);
+    resize.width = decoder.i32();
+    resize.height = decoder.i32();
 }
 
-template <typename Archive>
-void serialize(Archive& ar, command_arguments::config::gap& gap)
+void encode(Encoder& encoder, const command_arguments::config& config)
 {
-    ar(gap.gap);
+    encoder.u8(static_cast<uint8_t>(config.config.index()));
+    if (auto* mouse_mod = std::get_if<command_arguments::config::mouse_mod>(&config.config)) {
+        encoder.strings(mouse_mod->modifiers);
+    } else if (auto* gap = std::get_if<command_arguments::config::gap>(&config.config)) {
+        encoder.i32(gap->gap);
+    } else if (auto* focus_color = std::get_if<command_arguments::config::focus_color>(&config.config)) {
+        encoder.f32(focus_color->r);
+        encoder.f32(focus_color->g);
+        encoder.f32(focus_color->b);
+        encoder.f32(focus_color->a);
+    }
 }
 
-template <typename Archive>
-void serialize(Archive& ar, command_arguments::config::focus_color& focus_color)
+void decode(Decoder& decoder, command_arguments::config& config)
 {
-    ar(focus_color.r, focus_color.g, focus_color.b, focus_color.a);
+    switch (decoder.u8()) {
+    case 0:
+        config.config = command_arguments::config::mouse_mod { decoder.strings() };
+        break;
+    case 1:
+        config.config = command_arguments::config::gap { decoder.i32() };
+        break;
+    case 2: {
+        command_arguments::config::focus_color focus_color;
+        focus_color.r = decoder.f32();
+        focus_color.g = decoder.f32();
+        focus_color.b = decoder.f32();
+        focus_color.a = decoder.f32();
+        config.config = focus_color;
+        break;
+    }
+    default:
+        decoder.fail("invalid config command");
+    }
 }
 
-template <typename Archive>
-void serialize(Archive& ar, command_arguments::config& config)
+void encode(Encoder& encoder, const command_arguments::mode& mode)
 {
-    ar(config.config);
+    encoder.string(mode.name);
 }
 
-template <typename Archive>
-void serialize(Archive&, command_arguments::cycle_width&)
+void decode(Decoder& decoder, command_arguments::mode& mode)
 {
+    mode.name = decoder.string();
 }
+
+void encode(Encoder& encoder, const command_arguments::query& query)
+{
+    encoder.u8(static_cast<uint8_t>(query.kind));
+    encoder.u8(query.json);
 }
-/// \endcond
 
-tl::expected<CommandData, std::string> read_command_data(void* data, size_t size)
+void decode(Decoder& decoder, command_arguments::query& query)
 {
-    try {
-        std::string buffer(static_cast<char*>(data), size);
-        std::istringstream buffer_stream { buffer };
-        cereal::PortableBinaryInputArchive archive { buffer_stream };
+    uint8_t kind = decoder.u8();
+    if (kind > static_cast<uint8_t>(command_arguments::query::Kind::Focused)) {
+        decoder.fail("invalid query");
+    }
+    query.kind = static_cast<command_arguments::query::Kind>(kind);
+    query.json = decoder.u8() != 0;
+}
 
-        CommandData command_data;
-        archive(command_data);
+/// Commands without arguments.
+template <typename T>
+requires std::is_empty_v<T> void encode(Encoder&, const T&)
+{
+}
 
-        return command_data;
-    } catch (const cereal::Exception& e) {
-        return tl::unexpected(std::string { e.what() });
+template <typename T>
+requires std::is_empty_v<T> void decode(Decoder&, T&)
+{
+}
+
+void encode(Encoder& encoder, const CommandData& command_data)
+{
+    encoder.u8(static_cast<uint8_t>(command_data.index()));
+    std::visit([&encoder](const auto& arguments) { encode(encoder, arguments); }, command_data);
+}
+
+template <size_t I = 0>
+CommandData decode_alternative(Decoder& decoder, size_t index)
+{
+    if constexpr (I < std::variant_size_v<CommandData>) {
+        if (index == I) {
+            std::variant_alternative_t<I, CommandData> arguments;
+            decode(decoder, arguments);
+            return arguments;
+        }
+        return decode_alternative<I + 1>(decoder, index);
+    } else {
+        decoder.fail("unknown command " + std::to_string(index));
+        return {};
     }
 }
 
-tl::expected<std::string, std::string> write_command_data(const CommandData& command_data)
+CommandData decode(Decoder& decoder)
+{
+    return decode_alternative(decoder, decoder.u8());
+}
+
+}
+/// \endcond
+
+size_t encoded_command_size(const CommandData& command_data)
+{
+    Encoder encoder { {} };
+    encoder.u8(std::to_integer<uint8_t>(COMMAND_WIRE_MAGIC));
+    encoder.u8(COMMAND_WIRE_VERSION);
+    encode(encoder, command_data);
+
+    return encoder.size();
+}
+
+size_t encode_command(const CommandData& command_data, std::span<std::byte> buffer)
+{
+    Encoder encoder { buffer };
+    encoder.u8(std::to_integer<uint8_t>(COMMAND_WIRE_MAGIC));
+    encoder.u8(COMMAND_WIRE_VERSION);
+    encode(encoder, command_data);
+
+    return encoder.size() <= buffer.size() ? encoder.size() : 0;
+}
+
+tl::expected<CommandData, std::string> decode_command(std::span<const std::byte> buffer)
 {
     using namespace std::string_literals;
 
-    std::stringstream buffer_stream;
+    Decoder decoder { buffer };
+    if (decoder.u8() != std::to_integer<uint8_t>(COMMAND_WIRE_MAGIC)) {
+        return tl::unexpected("not a binary encoded command"s);
+    }
+    if (uint8_t version = decoder.u8(); version != COMMAND_WIRE_VERSION) {
+        return tl::unexpected("unsupported wire format version "s + std::to_string(version));
+    }
 
-    {
-        cereal::PortableBinaryOutputArchive archive { buffer_stream };
-        archive(command_data);
+    CommandData command_data = decode(decoder);
+    if (!decoder.error && !decoder.at_end()) {
+        decoder.fail("trailing bytes after the command");
+    }
+    if (decoder.error) {
+        return tl::unexpected(*decoder.error);
     }
 
-    return buffer_stream.str();
+    return command_data;
+}
+
+tl::expected<std::string, std::string> write_command_data(const CommandData& command_data)
+{
+    std::string buffer(encoded_command_size(command_data), '\0');
+    encode_command(command_data, std::as_writable_bytes(std::span { buffer }));
+
+    return buffer;
 }
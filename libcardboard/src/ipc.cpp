@@ -1,36 +1,94 @@
 #include <cardboard/ipc.h>
 
 #include <bit>
+#include <cstring>
 
 namespace libcardboard::ipc {
 
-Header interpret_header(const AlignedHeaderBuffer& buffer)
+/// Converts between the native byte order and the little endian byte order of the wire format.
+static uint32_t to_little_endian(uint32_t r)
 {
-    if constexpr (std::endian::native == std::endian::little) {
-        return { *reinterpret_cast<const int32_t*>(buffer.data()) };
-    } else {
-        uint32_t r = *reinterpret_cast<const uint32_t*>(buffer.data());
-        r = (r & 0x000000ffu) << 24u | (r & 0x0000ff00u) << 8u | (r & 0x00ff0000u) >> 8u | (r & 0xff000000u) >> 24u;
+    if constexpr (std::endian::native == std::endian::big) {
+        r = ((r >> 24u) & 0x000000ffu) | ((r << 8u) & 0x00ff0000u) | ((r >> 8u) & 0x0000ff00u) | ((r << 24u) & 0xff000000u);
+    }
+
+    return r;
+}
+
+std::optional<Header> interpret_header(const AlignedHeaderBuffer& buffer)
+{
+    uint32_t magic_and_version, incoming_bytes, request_id;
+    std::memcpy(&magic_and_version, buffer.data(), sizeof(magic_and_version));
+    std::memcpy(&incoming_bytes, buffer.data() + 4, sizeof(incoming_bytes));
+    std::memcpy(&request_id, buffer.data() + 8, sizeof(request_id));
 
-        return { static_cast<int>(r) };
+    magic_and_version = to_little_endian(magic_and_version);
+    if ((magic_and_version & 0xffffu) != HEADER_MAGIC) {
+        return std::nullopt;
     }
+
+    return Header {
+        .incoming_bytes = static_cast<int>(to_little_endian(incoming_bytes)),
+        .request_id = to_little_endian(request_id),
+        .version = static_cast<uint16_t>(magic_and_version >> 16u),
+    };
 }
 
 AlignedHeaderBuffer create_header_buffer(const Header& header)
 {
     AlignedHeaderBuffer buffer;
 
-    *reinterpret_cast<int*>(buffer.data()) = header.incoming_bytes;
+    uint32_t magic_and_version = to_little_endian(HEADER_MAGIC | (static_cast<uint32_t>(header.version) << 16u));
+    uint32_t incoming_bytes = to_little_endian(static_cast<uint32_t>(header.incoming_bytes));
+    uint32_t request_id = to_little_endian(header.request_id);
+    std::memcpy(buffer.data(), &magic_and_version, sizeof(magic_and_version));
+    std::memcpy(buffer.data() + 4, &incoming_bytes, sizeof(incoming_bytes));
+    std::memcpy(buffer.data() + 8, &request_id, sizeof(request_id));
 
-    if constexpr (std::endian::native == std::endian::big) {
-        uint32_t r = *reinterpret_cast<int*>(buffer.data());
+    return buffer;
+}
 
-        r = ((r >> 24u) & 0x000000ffu) | ((r << 8u) & 0x00ff0000u) | ((r >> 8u) & 0x0000ff00u) | ((r << 24u) & 0xff000000u);
+template <typename T>
+static void append_little_endian(std::string& buffer, T value)
+{
+    for (size_t i = 0; i < sizeof(T); i++) {
+        buffer += static_cast<char>((static_cast<uint64_t>(value) >> (8 * i)) & 0xffu);
+    }
+}
 
-        *reinterpret_cast<int*>(buffer.data()) = r;
+template <typename T>
+static T load_little_endian(const std::byte* data)
+{
+    uint64_t value = 0;
+    for (size_t i = 0; i < sizeof(T); i++) {
+        value |= static_cast<uint64_t>(data[i]) << (8 * i);
     }
 
-    return buffer;
+    return static_cast<T>(value);
+}
+
+void write_event(const Event& event, std::string& buffer)
+{
+    buffer += static_cast<char>(event.type);
+    append_little_endian(buffer, static_cast<uint32_t>(event.workspace));
+    append_little_endian(buffer, event.view);
+    append_little_endian(buffer, event.dropped);
+    buffer += event.output;
 }
 
-}
\ No newline at end of file
+std::optional<Event> read_event(const std::byte* data, std::size_t size)
+{
+    if (size < EVENT_FIXED_SIZE || static_cast<uint8_t>(data[0]) > static_cast<uint8_t>(EventType::EventsDropped)) {
+        return std::nullopt;
+    }
+
+    return Event {
+        .type = static_cast<EventType>(data[0]),
+        .workspace = static_cast<int32_t>(load_little_endian<uint32_t>(data + 1)),
+        .view = load_little_endian<uint64_t>(data + 5),
+        .dropped = load_little_endian<uint32_t>(data + 13),
+        .output = std::string(reinterpret_cast<const char*>(data) + EVENT_FIXED_SIZE, size - EVENT_FIXED_SIZE),
+    };
+}
+
+}
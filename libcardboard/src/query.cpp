@@ -0,0 +1,260 @@
+#include <cardboard/command_protocol.h>
+#include <cardboard/query.h>
+
+#include <cinttypes>
+#include <cstdio>
+
+#include "wire.h"
+
+namespace libcardboard::query {
+
+using wire::Decoder;
+using wire::Encoder;
+
+/// \cond IGNORE
+namespace {
+
+template <typename T, typename F>
+void encode_vector(Encoder& encoder, const std::vector<T>& values, F&& encode_value)
+{
+    encoder.u32(static_cast<uint32_t>(values.size()));
+    for (const auto& value : values) {
+        encode_value(encoder, value);
+    }
+}
+
+/// Every encoded element takes at least \a min_size bytes, which bounds what a malformed count can reserve.
+template <typename T, typename F>
+std::vector<T> decode_vector(Decoder& decoder, size_t min_size, F&& decode_value)
+{
+    uint32_t count = decoder.u32();
+
+    std::vector<T> values;
+    if (!decoder.can_read(static_cast<size_t>(count) * min_size)) {
+        return values;
+    }
+    values.reserve(count);
+    for (uint32_t i = 0; i < count && !decoder.error; i++) {
+        values.push_back(decode_value(decoder));
+    }
+    return values;
+}
+
+void encode_box(Encoder& encoder, const Box& box)
+{
+    encoder.i32(box.x);
+    encoder.i32(box.y);
+    encoder.i32(box.width);
+    encoder.i32(box.height);
+}
+
+Box decode_box(Decoder& decoder)
+{
+    Box box;
+    box.x = decoder.i32();
+    box.y = decoder.i32();
+    box.width = decoder.i32();
+    box.height = decoder.i32();
+    return box;
+}
+
+void encode_view(Encoder& encoder, const View& view)
+{
+    encoder.u64(view.id);
+    encoder.i32(view.workspace);
+    encode_box(encoder, view.geometry);
+    encoder.u8(view.floating);
+    encoder.u8(view.fullscreen);
+}
+
+View decode_view(Decoder& decoder)
+{
+    View view;
+    view.id = decoder.u64();
+    view.workspace = decoder.i32();
+    view.geometry = decode_box(decoder);
+    view.floating = decoder.u8() != 0;
+    view.fullscreen = decoder.u8() != 0;
+    return view;
+}
+
+constexpr size_t ENCODED_VIEW_SIZE = 8 + 4 + 16 + 2;
+
+void encode_workspace(Encoder& encoder, const Workspace& workspace)
+{
+    encoder.i32(workspace.index);
+    encoder.string(workspace.output);
+    encoder.i32(workspace.scroll_x);
+    encode_vector(encoder, workspace.columns, [](Encoder& encoder, const Column& column) {
+        encode_vector(encoder, column.tiles, encode_view);
+    });
+    encode_vector(encoder, workspace.floating_views, encode_view);
+}
+
+Workspace decode_workspace(Decoder& decoder)
+{
+    Workspace workspace;
+    workspace.index = decoder.i32();
+    workspace.output = decoder.string();
+    workspace.scroll_x = decoder.i32();
+    workspace.columns = decode_vector<Column>(decoder, 4, [](Decoder& decoder) {
+        return Column { decode_vector<View>(decoder, ENCODED_VIEW_SIZE, decode_view) };
+    });
+    workspace.floating_views = decode_vector<View>(decoder, ENCODED_VIEW_SIZE, decode_view);
+    return workspace;
+}
+
+void encode_output(Encoder& encoder, const Output& output)
+{
+    encoder.string(output.name);
+    encode_box(encoder, output.box);
+    encode_box(encoder, output.usable_area);
+}
+
+Output decode_output(Decoder& decoder)
+{
+    Output output;
+    output.name = decoder.string();
+    output.box = decode_box(decoder);
+    output.usable_area = decode_box(decoder);
+    return output;
+}
+
+/// Appends \a value as a JSON string literal.
+void append_json_string(std::string& json, const std::string& value)
+{
+    json += '"';
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            json += '\\';
+            json += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            json += escaped;
+        } else {
+            json += c;
+        }
+    }
+    json += '"';
+}
+
+void append_json_box(std::string& json, const Box& box)
+{
+    char buffer[96];
+    std::snprintf(buffer, sizeof(buffer), "{\"x\":%" PRId32 ",\"y\":%" PRId32 ",\"width\":%" PRId32 ",\"height\":%" PRId32 "}", box.x, box.y, box.width, box.height);
+    json += buffer;
+}
+
+void append_json_view(std::string& json, const View& view)
+{
+    char buffer[96];
+    std::snprintf(buffer, sizeof(buffer), "{\"id\":%" PRIu64 ",\"workspace\":%" PRId32 ",\"geometry\":", view.id, view.workspace);
+    json += buffer;
+    append_json_box(json, view.geometry);
+    json += ",\"floating\":";
+    json += view.floating ? "true" : "false";
+    json += ",\"fullscreen\":";
+    json += view.fullscreen ? "true" : "false";
+    json += '}';
+}
+
+template <typename T, typename F>
+void append_json_array(std::string& json, const std::vector<T>& values, F&& append_value)
+{
+    json += '[';
+    for (size_t i = 0; i < values.size(); i++) {
+        if (i > 0) {
+            json += ',';
+        }
+        append_value(json, values[i]);
+    }
+    json += ']';
+}
+
+}
+/// \endcond
+
+std::string encode_state(const State& state)
+{
+    return wire::encode_to_string([&state](Encoder& encoder) {
+        encoder.u8(std::to_integer<uint8_t>(COMMAND_WIRE_MAGIC));
+        encoder.u8(STATE_WIRE_VERSION);
+        encode_vector(encoder, state.outputs, encode_output);
+        encode_vector(encoder, state.workspaces, encode_workspace);
+        encoder.i32(state.focused_workspace);
+        encoder.u8(state.focused_view.has_value());
+        if (state.focused_view) {
+            encode_view(encoder, *state.focused_view);
+        }
+    });
+}
+
+tl::expected<State, std::string> decode_state(std::span<const std::byte> buffer)
+{
+    using namespace std::string_literals;
+
+    Decoder decoder { buffer };
+    if (decoder.u8() != std::to_integer<uint8_t>(COMMAND_WIRE_MAGIC)) {
+        return tl::unexpected("not a binary encoded state"s);
+    }
+    if (uint8_t version = decoder.u8(); version != STATE_WIRE_VERSION) {
+        return tl::unexpected("unsupported state format version "s + std::to_string(version));
+    }
+
+    State state;
+    state.outputs = decode_vector<Output>(decoder, 4 + 32, decode_output);
+    state.workspaces = decode_vector<Workspace>(decoder, 20, decode_workspace);
+    state.focused_workspace = decoder.i32();
+    if (decoder.u8() != 0) {
+        state.focused_view = decode_view(decoder);
+    }
+
+    if (!decoder.error && !decoder.at_end()) {
+        decoder.fail("trailing bytes after the state");
+    }
+    if (decoder.error) {
+        return tl::unexpected(*decoder.error);
+    }
+
+    return state;
+}
+
+std::string state_to_json(const State& state)
+{
+    std::string json = "{\"outputs\":";
+    append_json_array(json, state.outputs, [](std::string& json, const Output& output) {
+        json += "{\"name\":";
+        append_json_string(json, output.name);
+        json += ",\"box\":";
+        append_json_box(json, output.box);
+        json += ",\"usable_area\":";
+        append_json_box(json, output.usable_area);
+        json += '}';
+    });
+
+    json += ",\"workspaces\":";
+    append_json_array(json, state.workspaces, [](std::string& json, const Workspace& workspace) {
+        json += "{\"index\":" + std::to_string(workspace.index) + ",\"output\":";
+        append_json_string(json, workspace.output);
+        json += ",\"scroll_x\":" + std::to_string(workspace.scroll_x) + ",\"columns\":";
+        append_json_array(json, workspace.columns, [](std::string& json, const Column& column) {
+            append_json_array(json, column.tiles, append_json_view);
+        });
+        json += ",\"floating_views\":";
+        append_json_array(json, workspace.floating_views, append_json_view);
+        json += '}';
+    });
+
+    json += ",\"focused_workspace\":" + std::to_string(state.focused_workspace) + ",\"focused_view\":";
+    if (state.focused_view) {
+        append_json_view(json, *state.focused_view);
+    } else {
+        json += "null";
+    }
+    json += "}\n";
+
+    return json;
+}
+
+}
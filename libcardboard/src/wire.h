@@ -0,0 +1,215 @@
+#ifndef LIBCARDBOARD_WIRE_H_INCLUDED
+#define LIBCARDBOARD_WIRE_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+/// Primitives of the binary wire format shared by commands and query responses. Not installed.
+namespace libcardboard::wire {
+
+/// Writes the binary wire format into a buffer. Past the end of the buffer, it only counts the bytes.
+class Encoder {
+public:
+    explicit Encoder(std::span<std::byte> buffer)
+        : buffer { buffer }
+    {
+    }
+
+    void u8(uint8_t value)
+    {
+        if (offset < buffer.size()) {
+            buffer[offset] = static_cast<std::byte>(value);
+        }
+        offset++;
+    }
+
+    void u32(uint32_t value)
+    {
+        for (int i = 0; i < 4; i++) {
+            u8(static_cast<uint8_t>(value >> (8 * i)));
+        }
+    }
+
+    void i32(int32_t value)
+    {
+        u32(static_cast<uint32_t>(value));
+    }
+
+    void u64(uint64_t value)
+    {
+        u32(static_cast<uint32_t>(value));
+        u32(static_cast<uint32_t>(value >> 32));
+    }
+
+    void f32(float value)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        u32(bits);
+    }
+
+    void string(const std::string& value)
+    {
+        u32(static_cast<uint32_t>(value.size()));
+        if (offset + value.size() <= buffer.size()) {
+            std::memcpy(buffer.data() + offset, value.data(), value.size());
+        }
+        offset += value.size();
+    }
+
+    void strings(const std::vector<std::string>& values)
+    {
+        u32(static_cast<uint32_t>(values.size()));
+        for (const auto& value : values) {
+            string(value);
+        }
+    }
+
+    size_t size() const
+    {
+        return offset;
+    }
+
+private:
+    std::span<std::byte> buffer;
+    size_t offset = 0;
+};
+
+/// Reads the binary wire format. After the first error, reads return zeroes and #error tells what went wrong.
+class Decoder {
+public:
+    /// Nesting limit for bind commands, so that malicious input can't exhaust the stack.
+    static constexpr int MAX_DEPTH = 8;
+
+    explicit Decoder(std::span<const std::byte> buffer)
+        : buffer { buffer }
+    {
+    }
+
+    uint8_t u8()
+    {
+        if (!can_read(1)) {
+            return 0;
+        }
+        return static_cast<uint8_t>(buffer[offset++]);
+    }
+
+    uint32_t u32()
+    {
+        if (!can_read(4)) {
+            return 0;
+        }
+
+        uint32_t value = 0;
+        for (int i = 0; i < 4; i++) {
+            value |= static_cast<uint32_t>(buffer[offset++]) << (8 * i);
+        }
+        return value;
+    }
+
+    int32_t i32()
+    {
+        return static_cast<int32_t>(u32());
+    }
+
+    uint64_t u64()
+    {
+        uint64_t low = u32();
+        return low | static_cast<uint64_t>(u32()) << 32;
+    }
+
+    float f32()
+    {
+        uint32_t bits = u32();
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    std::string string()
+    {
+        uint32_t size = u32();
+        if (!can_read(size)) {
+            return {};
+        }
+
+        std::string value(reinterpret_cast<const char*>(buffer.data() + offset), size);
+        offset += size;
+        return value;
+    }
+
+    std::vector<std::string> strings()
+    {
+        uint32_t count = u32();
+        // every string takes at least its length prefix, don't reserve more than the input can hold
+        if (!can_read(static_cast<size_t>(count) * 4)) {
+            return {};
+        }
+
+        std::vector<std::string> values;
+        values.reserve(count);
+        for (uint32_t i = 0; i < count && !error; i++) {
+            values.push_back(string());
+        }
+        return values;
+    }
+
+    void fail(std::string message)
+    {
+        if (!error) {
+            error = std::move(message);
+        }
+    }
+
+    bool at_end() const
+    {
+        return offset == buffer.size();
+    }
+
+    std::optional<std::string> error;
+    int depth = 0;
+
+    /// Checks that \a size more bytes can be read, failing otherwise.
+    bool can_read(size_t size)
+    {
+        if (error) {
+            return false;
+        }
+        if (buffer.size() - offset < size) {
+            fail("unexpected end of data");
+            return false;
+        }
+        return true;
+    }
+
+private:
+    std::span<const std::byte> buffer;
+    size_t offset = 0;
+};
+
+/**
+ * \brief Encodes with \a encode into a string of the right size
+ *
+ * \a encode is called twice with an Encoder: once to measure, once to write.
+ */
+template <typename F>
+std::string encode_to_string(F&& encode)
+{
+    Encoder counter { {} };
+    encode(counter);
+
+    std::string buffer(counter.size(), '\0');
+    Encoder encoder { std::as_writable_bytes(std::span { buffer }) };
+    encode(encoder);
+
+    return buffer;
+}
+
+}
+
+#endif // LIBCARDBOARD_WIRE_H_INCLUDED